@@ -0,0 +1,88 @@
+#ifndef PANDA_STARTUPTRACE_H
+#define PANDA_STARTUPTRACE_H
+
+#include <QByteArray>
+#include <QThread>
+
+#include <chrono>
+#include <cstdio>
+
+#include <unistd.h>
+
+//* startup phases of the plugins as Chrome trace events
+/**
+with PANDA_TRACE_FILE set to a path, every StartupTrace::Scope appends a
+complete event with its start and duration to that file. The file can be
+loaded into chrome://tracing or Perfetto as is. Both plugins and any number of
+processes can append to the same file. The trace event format does not need
+the closing bracket of the event array.
+
+without the variable, a scope costs one check of a function local static.
+*/
+namespace StartupTrace
+{
+    //* trace file, nullptr unless PANDA_TRACE_FILE is set
+    inline std::FILE *file()
+    {
+        static std::FILE *const traceFile = []() -> std::FILE * {
+            const QByteArray path = qgetenv("PANDA_TRACE_FILE");
+            if (path.isEmpty())
+                return nullptr;
+            std::FILE *f = std::fopen(path.constData(), "a");
+            if (!f)
+                return nullptr;
+            std::fseek(f, 0, SEEK_END);
+            if (std::ftell(f) == 0)
+                std::fputs("[\n", f);
+            return f;
+        }();
+        return traceFile;
+    }
+
+    //* microseconds on the monotonic clock, which all processes share
+    inline long long now()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    //* append a complete event; name must not need JSON escaping
+    inline void writeEvent(const char *name, long long start, long long duration)
+    {
+        std::FILE *f = file();
+        if (!f)
+            return;
+        std::fprintf(f, "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%llu},\n",
+                     name, start, duration, int(getpid()),
+                     // only needs to tell threads apart, and unlike gettid it builds on FreeBSD
+                     static_cast<unsigned long long>(quintptr(QThread::currentThreadId())));
+        // one flush per event keeps appends from different plugins whole
+        std::fflush(f);
+    }
+
+    //* records the time from construction to destruction as one phase
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name)
+            : m_name(name),
+              m_start(file() ? now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (m_start)
+                writeEvent(m_name, m_start, now() - m_start);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *m_name;
+        long long m_start;
+    };
+}
+
+#endif // PANDA_STARTUPTRACE_H
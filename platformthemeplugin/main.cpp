@@ -1,5 +1,6 @@
 #include <qpa/qplatformthemeplugin.h>
 #include "pandaplatformtheme.h"
+#include "startuptrace.h"
 
 #include <private/xdgiconloader/xdgiconloader_p.h>
 
@@ -23,6 +24,7 @@ public:
     {
         Q_UNUSED(key)
         Q_UNUSED(paramList)
+        StartupTrace::Scope trace("PlatformThemePlugin::create");
         return new PandaPlatformTheme;
     }
 };
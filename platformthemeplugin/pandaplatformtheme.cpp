@@ -1,6 +1,7 @@
 #include "pandaplatformtheme.h"
 #include "x11integration.h"
 #include "qdbusmenubar_p.h"
+#include "startuptrace.h"
 
 #include <QApplication>
 #include <QFont>
@@ -40,7 +41,10 @@ static bool checkDBusGlobalMenuAvailable()
 
 static bool isDBusGlobalMenuAvailable()
 {
-    static bool dbusGlobalMenuAvailable = checkDBusGlobalMenuAvailable();
+    static bool dbusGlobalMenuAvailable = [] {
+        StartupTrace::Scope trace("D-Bus global menu probe");
+        return checkDBusGlobalMenuAvailable();
+    }();
     return dbusGlobalMenuAvailable;
 }
 
@@ -78,20 +82,36 @@ static void onIconThemeChanged()
     }
 }
 
-void onDarkModeChanged()
+void onDarkModeChanged(bool darkMode)
 {
+    if (!qobject_cast<QApplication *>(QCoreApplication::instance()))
+        return;
+
+    // Read by styles created from now on
+    qApp->setProperty("_panda_dark_mode", darkMode);
+
+    // Swap the palette of the running style in place when it is ours
+    QObject *pandaStyle = qvariant_cast<QObject *>(qApp->property("_panda_style_object"));
+    if (pandaStyle && QMetaObject::invokeMethod(pandaStyle, "setDarkMode", Q_ARG(bool, darkMode)))
+        return;
+
     QStyle *style = QStyleFactory::create("panda");
     if (style) {
+        QMetaObject::invokeMethod(style, "setDarkMode", Q_ARG(bool, darkMode));
         qApp->setStyle(style);
     }
 }
 
 PandaPlatformTheme::PandaPlatformTheme()
-    : m_hints(new HintsSettings)
 {
+    {
+        StartupTrace::Scope trace("HintsSettings");
+        m_hints = new HintsSettings;
+    }
     // qApp->setProperty("_hints_settings_object", (quintptr)m_hints);
 
     if (KWindowSystem::isPlatformX11()) {
+        StartupTrace::Scope trace("X11Integration::init");
         m_x11Integration.reset(new X11Integration());
         m_x11Integration->init();
     }
@@ -101,6 +121,10 @@ PandaPlatformTheme::PandaPlatformTheme()
     connect(m_hints, &HintsSettings::iconThemeChanged, &onIconThemeChanged);
     connect(m_hints, &HintsSettings::darkModeChanged, &onDarkModeChanged);
 
+    // The style starts in this mode, see onDarkModeChanged() for changes
+    if (QCoreApplication *app = QCoreApplication::instance())
+        app->setProperty("_panda_dark_mode", m_hints->darkMode());
+
     QCoreApplication::setAttribute(Qt::AA_DontUseNativeMenuBar, false);
     QCoreApplication::setAttribute(Qt::AA_DontShowIconsInMenus, true); // probono: need to use myAction->setIconVisibleInMenu(true); for menu items that shall get the icon nevertheless
 }
@@ -162,6 +186,7 @@ const QFont* PandaPlatformTheme::font(Font type) const
 
 QPlatformMenuBar *PandaPlatformTheme::createPlatformMenuBar() const
 {
+    StartupTrace::Scope trace("PandaPlatformTheme::createPlatformMenuBar");
     if (isDBusGlobalMenuAvailable()) {
         auto *menu = new QDBusMenuBar();
 
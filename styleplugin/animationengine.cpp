@@ -0,0 +1,110 @@
+#include "animationengine.h"
+
+#include <QWidget>
+
+namespace
+{
+    // Duration of a full transition, shorter if it starts halfway
+    const int Transition_Duration = 150;
+}
+
+AnimationEngine::AnimationEngine(QObject *parent)
+    : QAbstractAnimation(parent),
+      m_enabled(qEnvironmentVariable("PANDA_ANIMATIONS") != QLatin1String("0"))
+{
+}
+
+qreal AnimationEngine::value(const QWidget *widget, int subControl, Kind kind, bool active, const QRect &rect)
+{
+    if (!m_enabled || !widget)
+        return active ? 1.0 : 0.0;
+
+    const Key key {widget, subControl, kind};
+    auto it = m_states.find(key);
+    if (it == m_states.end()) {
+        // the first paint shows the current state right away
+        if (!m_widgets.contains(widget)) {
+            m_widgets.insert(widget);
+            connect(widget, &QObject::destroyed, this, &AnimationEngine::unregisterWidget);
+        }
+        m_states.insert(key, active);
+        return active ? 1.0 : 0.0;
+    }
+
+    Transition *transition = nullptr;
+    for (Transition &candidate : m_transitions) {
+        if (candidate.key == key) {
+            transition = &candidate;
+            break;
+        }
+    }
+
+    if (it.value() != active) {
+        it.value() = active;
+        // the engine runs exactly while there are transitions, so starting it
+        // here does not move the clock under any other transition
+        if (state() != Running)
+            start();
+        const int now = currentTime();
+        const float from = transition ? float(progress(*transition, now)) : (active ? 0.0f : 1.0f);
+        const float to = active ? 1.0f : 0.0f;
+        // a reversed transition continues from where it currently is
+        const int startTime = now - int(Transition_Duration * (1.0f - qAbs(to - from)));
+        if (transition) {
+            transition->from = active ? 0.0f : 1.0f;
+            transition->to = to;
+            transition->startTime = startTime;
+        } else {
+            m_transitions.append({key, rect, active ? 0.0f : 1.0f, to, startTime});
+            transition = &m_transitions.last();
+        }
+    }
+
+    if (!transition)
+        return active ? 1.0 : 0.0;
+
+    transition->rect = rect;
+    return progress(*transition, currentTime());
+}
+
+void AnimationEngine::unregisterWidget(QObject *widget)
+{
+    if (!m_widgets.remove(widget))
+        return;
+
+    for (auto it = m_states.begin(); it != m_states.end();) {
+        if (it.key().widget == widget)
+            it = m_states.erase(it);
+        else
+            ++it;
+    }
+
+    for (int i = m_transitions.size() - 1; i >= 0; --i) {
+        if (m_transitions.at(i).key.widget == widget)
+            m_transitions.remove(i);
+    }
+
+    if (m_transitions.isEmpty())
+        stop();
+}
+
+void AnimationEngine::updateCurrentTime(int currentTime)
+{
+    for (int i = m_transitions.size() - 1; i >= 0; --i) {
+        const Transition &transition = m_transitions.at(i);
+        const_cast<QWidget *>(transition.key.widget)->update(transition.rect);
+        // the last frame is painted with the final state
+        if (currentTime - transition.startTime >= Transition_Duration)
+            m_transitions.remove(i);
+    }
+
+    // nothing left to animate, go idle
+    if (m_transitions.isEmpty())
+        stop();
+}
+
+qreal AnimationEngine::progress(const Transition &transition, int time)
+{
+    const qreal t = qBound(0.0, qreal(time - transition.startTime) / Transition_Duration, 1.0);
+    return transition.from + (transition.to - transition.from) * t;
+}
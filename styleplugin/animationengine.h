@@ -0,0 +1,89 @@
+#ifndef ANIMATIONENGINE_H
+#define ANIMATIONENGINE_H
+
+#include <QAbstractAnimation>
+#include <QHash>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
+class QWidget;
+
+//* hover and press transitions of all widgets, driven by one shared clock
+/**
+the engine is a single QAbstractAnimation, so it is ticked by Qt's per-thread
+unified animation timer along with every other animation, in step with the
+animation driver. It only runs while a transition is in progress, and every
+tick repaints just the rects of the sub-controls that are changing.
+
+painting code asks for the progress of a sub-control towards its active state;
+a transition starts whenever that state differs from the one seen last time.
+*/
+class AnimationEngine : public QAbstractAnimation
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Hover,
+        Press,
+    };
+
+    //* constructor
+    explicit AnimationEngine(QObject *parent = nullptr);
+
+    //* false if disabled with PANDA_ANIMATIONS=0
+    bool isEnabled() const
+    { return m_enabled; }
+
+    //* progress from 0 (inactive) to 1 (active) of the given sub-control of widget
+    qreal value(const QWidget *widget, int subControl, Kind kind, bool active, const QRect &rect);
+
+    //* forget all state of widget
+    void unregisterWidget(QObject *widget);
+
+    //* runs until stopped
+    int duration() const override
+    { return -1; }
+
+protected:
+    void updateCurrentTime(int currentTime) override;
+
+private:
+    struct Key
+    {
+        const QWidget *widget;
+        int subControl;
+        int kind;
+
+        bool operator==(const Key &other) const
+        { return widget == other.widget && subControl == other.subControl && kind == other.kind; }
+    };
+    friend uint qHash(const Key &key, uint seed)
+    { return ::qHash(key.widget, seed) ^ uint(key.subControl << 4 | key.kind); }
+
+    struct Transition
+    {
+        Key key;
+        QRect rect;
+        float from;
+        float to;
+        int startTime;
+    };
+
+    //* progress of transition at time
+    static qreal progress(const Transition &transition, int time);
+
+    //* last seen active state of every sub-control
+    QHash<Key, bool> m_states;
+
+    //* transitions in progress
+    QVector<Transition> m_transitions;
+
+    //* widgets with entries in m_states
+    QSet<const QObject *> m_widgets;
+
+    bool m_enabled;
+};
+
+#endif // ANIMATIONENGINE_H
@@ -23,13 +23,25 @@
 #include "basestyle.h"
 #include "phantomcolor.h"
 #include "shadowhelper.h"
+#include "polishhelper.h"
+#include "themeparams.h"
+#include "stylesheetloader.h"
+#include "animationengine.h"
+#include "comboboxmenudelegate.h"
+#include "prewarmscheduler.h"
+#include "paintprofiler.h"
+#include "startuptrace.h"
 
 #include <QAbstractItemView>
 #include <QApplication>
+#include <QAtomicInt>
+#include <QCache>
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QFile>
+#include <QHash>
 #include <QHeaderView>
+#include <QLineEdit>
 #include <QListView>
 #include <QMainWindow>
 #include <QMenu>
@@ -39,6 +51,7 @@
 #include <QPolygon>
 #include <QPushButton>
 #include <QProgressBar>
+#include <QReadWriteLock>
 #include <QScrollBar>
 #include <QSharedData>
 #include <QSlider>
@@ -47,9 +60,12 @@
 #include <QString>
 #include <QStyleOption>
 #include <QTableView>
+#include <QThread>
+#include <QThreadStorage>
 #include <QToolBar>
 #include <QToolButton>
 #include <QTreeView>
+#include <QVarLengthArray>
 #include <QWindow>
 #include <QWizard>
 #include <QtMath>
@@ -57,9 +73,11 @@
 
 #include <QSettings>
 
+#include <algorithm>
 #include <cmath>
 
 #include <QStandardPaths>
+#include <QStaticText>
 #include <QDebug>
 #include <QMessageBox>
 #include <QErrorMessage>
@@ -158,6 +176,8 @@ namespace Phantom
         // Note that this only applies to the disclosure etc. decorators in tree views.
         constexpr bool ShowItemViewDecorationSelected = false;
         constexpr bool UseQMenuForComboBoxPopup = true;
+        // Combo boxes with more items than this drop down a list instead of a menu
+        constexpr int ComboBoxMenuPopup_MaxItems = 100;
         constexpr bool ItemView_UseFontHeightForDecorationSize = true;
 
         // Whether or not the non-raised tabs in a tab bar have shininess/highlights to
@@ -591,6 +611,7 @@ namespace Phantom
                 }
             }
             if (idx == -1) {
+                PaintProfiler::count(PaintProfiler::SwatchMiss);
                 PhSwatchPtr ptr;
                 if (n < Num_ColorCacheEntries) {
                     ptr = new PhSwatch;
@@ -614,6 +635,7 @@ namespace Phantom
                 cache->prepend(PhCacheEntry(key, ptr));
                 return ptr;
             } else {
+                PaintProfiler::count(PaintProfiler::SwatchHit);
                 if (idx == 0) {
                     return cache->at(idx).second;
                 }
@@ -639,12 +661,389 @@ namespace Phantom
             // rare in my tests. (Probably not going to amount to any significant
             // difference, anyway.)
             if (Q_LIKELY(cacheCount > 0 && *headSwatchFastKey == ck)) {
+                PaintProfiler::count(PaintProfiler::SwatchFastHit);
                 return cache->at(0).second;
             }
             *headSwatchFastKey = ck;
             return deep_getCachedSwatchOfQPalette(cache, cacheCount, qpalette);
         }
 
+        // Memoization of sizeFromContents() for the contents types that have to
+        // measure text. Item views and headers ask for the same few sizes over and
+        // over again while laying out, scrolling and resizing sections.
+        constexpr int SizeCache_MaxEntries = 1024;
+
+        // Only plain ints, so it can be hashed and compared bytewise.
+        struct SizeCacheKey
+        {
+            int type = 0;
+            int fontHeight = 0;
+            uint textHash = 0;
+            int width = 0;
+            int height = 0;
+            int iconWidth = 0;
+            int iconHeight = 0;
+            int flags = 0;
+            int extra = 0;
+
+            bool operator==(const SizeCacheKey& other) const
+            {
+                return memcmp(this, &other, sizeof(SizeCacheKey)) == 0;
+            }
+        };
+
+        inline uint qHash(const SizeCacheKey& key, uint seed = 0)
+        {
+            return qHashBits(&key, sizeof(SizeCacheKey), seed);
+        }
+
+        // The key only carries the font height, so an entry also keeps the font
+        // metrics and text it was computed for and is only used if both match.
+        struct SizeCacheEntry
+        {
+            QFontMetrics fontMetrics;
+            QString text;
+            QSize size;
+        };
+
+        using SizeCache = QCache<SizeCacheKey, SizeCacheEntry>;
+
+        // Text layout caches for drawItemText() and the elided titles. Menu bars,
+        // dock and title bars, headers and button labels paint the same strings on
+        // every repaint, and shaping them again each time dominates those paints.
+        constexpr int TextCache_MaxEntries = 512;
+
+        enum TextCacheKind
+        {
+            TextCache_Elided = 1,
+            TextCache_Static,
+        };
+
+        // Only plain ints, so it can be hashed and compared bytewise.
+        struct TextCacheKey
+        {
+            int kind = 0;
+            uint fontHash = 0;
+            int dpi = 0;
+            uint textHash = 0;
+            int width = 0;
+            int flags = 0;
+
+            bool operator==(const TextCacheKey& other) const
+            {
+                return memcmp(this, &other, sizeof(TextCacheKey)) == 0;
+            }
+        };
+
+        inline uint qHash(const TextCacheKey& key, uint seed = 0)
+        {
+            return qHashBits(&key, sizeof(TextCacheKey), seed);
+        }
+
+        // Like SizeCacheEntry, the font and text are compared before an entry is used.
+        struct TextCacheEntry
+        {
+            QFont font;
+            QString text;
+            QString elidedText;
+            QStaticText staticText;
+        };
+
+        using TextCache = QCache<TextCacheKey, TextCacheEntry>;
+
+        // What qt_format_text() shows for a label with mnemonics hidden
+        inline QString removeMnemonics(const QString& text)
+        {
+            QString result;
+            result.reserve(text.size());
+            for (int i = 0; i < text.size(); ++i) {
+                if (text.at(i) == QLatin1Char('&')) {
+                    ++i;
+                    if (i == text.size())
+                        break;
+                }
+                result.append(text.at(i));
+            }
+            return result;
+        }
+
+        // generatedIconPixmap() results. Item views ask for the selected variant of
+        // every icon in a selected row on each repaint.
+        constexpr int IconCache_MaxCostKiB = 8192;
+
+        // Only plain ints, so it can be hashed and compared bytewise.
+        struct IconCacheKey
+        {
+            qint64 pixmapKey = 0;
+            QRgb color = 0;
+            int mode = 0;
+
+            bool operator==(const IconCacheKey& other) const
+            {
+                return memcmp(this, &other, sizeof(IconCacheKey)) == 0;
+            }
+        };
+
+        inline uint qHash(const IconCacheKey& key, uint seed = 0)
+        {
+            return qHashBits(&key, sizeof(IconCacheKey), seed);
+        }
+
+        using IconCache = QCache<IconCacheKey, QPixmap>;
+
+        // Same result as filling an ARGB32_Premultiplied image with tint using
+        // CompositionMode_SourceAtop, without setting up a QPainter.
+        inline void tintPremultiplied(QImage* image, QRgb tint)
+        {
+            Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
+            const QRgb premultipliedTint = qPremultiply(tint);
+            const uint tintRed = qRed(premultipliedTint);
+            const uint tintGreen = qGreen(premultipliedTint);
+            const uint tintBlue = qBlue(premultipliedTint);
+            const uint inverseTintAlpha = 255 - qAlpha(premultipliedTint);
+            const int width = image->width();
+            for (int y = 0; y < image->height(); ++y) {
+                QRgb* line = reinterpret_cast<QRgb*>(image->scanLine(y));
+                for (int x = 0; x < width; ++x) {
+                    const QRgb pixel = line[x];
+                    const uint alpha = qAlpha(pixel);
+                    const uint red = (tintRed * alpha + qRed(pixel) * inverseTintAlpha + 127) / 255;
+                    const uint green = (tintGreen * alpha + qGreen(pixel) * inverseTintAlpha + 127) / 255;
+                    const uint blue = (tintBlue * alpha + qBlue(pixel) * inverseTintAlpha + 127) / 255;
+                    line[x] = (alpha << 24) | (red << 16) | (green << 8) | blue;
+                }
+            }
+        }
+
+        // QCommonStyle's disabled icon effect: maps the gray level of every pixel
+        // into a black -> background -> white ramp, keeping alpha.
+        inline void disableARGB32(QImage* image, const QColor& background)
+        {
+            Q_ASSERT(image->format() == QImage::Format_ARGB32);
+            const int red = background.red();
+            const int green = background.green();
+            const int blue = background.blue();
+            uchar reds[256], greens[256], blues[256];
+            for (int i = 0; i < 128; ++i) {
+                reds[i] = uchar((red * (i << 1)) >> 8);
+                greens[i] = uchar((green * (i << 1)) >> 8);
+                blues[i] = uchar((blue * (i << 1)) >> 8);
+            }
+            for (int i = 0; i < 128; ++i) {
+                reds[i + 128] = uchar(qMin(red + (i << 1), 255));
+                greens[i + 128] = uchar(qMin(green + (i << 1), 255));
+                blues[i + 128] = uchar(qMin(blue + (i << 1), 255));
+            }
+            int intensity = (77 * red + 150 * green + 28 * blue) / 255;
+            const int factor = 191;
+            // High intensity colors need dark shifting in the color table, low
+            // intensity colors light shifting, to increase the perceived contrast.
+            if ((red - factor > green && red - factor > blue) || (green - factor > red && green - factor > blue)
+                || (blue - factor > red && blue - factor > green))
+                intensity = qMin(255, intensity + 91);
+            else if (intensity <= 128)
+                intensity -= 51;
+            const int offset = 130 - intensity / 3;
+            const int width = image->width();
+            for (int y = 0; y < image->height(); ++y) {
+                QRgb* line = reinterpret_cast<QRgb*>(image->scanLine(y));
+                for (int x = 0; x < width; ++x) {
+                    const QRgb pixel = line[x];
+                    const uint ci = uint(qGray(pixel) / 3 + offset);
+                    line[x] = qRgba(reds[ci], greens[ci], blues[ci], qAlpha(pixel));
+                }
+            }
+        }
+
+        // Recently computed subControlRect() results of scroll bars, sliders, spin
+        // boxes and combo boxes. Painting asks for the rects of several
+        // sub-controls, and hit testing on every mouse move asks for the same
+        // ones again, so a handful of entries covers a whole drag.
+        constexpr int GeometryCache_Size = 16;
+
+        // Only plain ints, so it can be hashed and compared bytewise.
+        struct GeometryCacheKey
+        {
+            quintptr widget = 0;
+            int control = 0;
+            int subControl = 0;
+            int x = 0;
+            int y = 0;
+            int width = 0;
+            int height = 0;
+            int direction = 0;
+            int fontHeight = 0;
+            int subControls = 0;
+            int flags = 0;
+            int orientation = 0;
+            int minimum = 0;
+            int maximum = 0;
+            int position = 0;
+            int pageStep = 0;
+            int singleStep = 0;
+
+            bool operator==(const GeometryCacheKey& other) const
+            {
+                return memcmp(this, &other, sizeof(GeometryCacheKey)) == 0;
+            }
+        };
+
+        // Everything the geometry of these controls is computed from. Returns false
+        // for anything that is not worth caching.
+        inline bool geometryCacheKey(QStyle::ComplexControl control,
+                                     const QStyleOptionComplex* option,
+                                     QStyle::SubControl subControl,
+                                     const QWidget* widget,
+                                     GeometryCacheKey* key)
+        {
+            if (!option)
+                return false;
+            key->widget = reinterpret_cast<quintptr>(widget);
+            key->control = control;
+            key->subControl = subControl;
+            key->x = option->rect.x();
+            key->y = option->rect.y();
+            key->width = option->rect.width();
+            key->height = option->rect.height();
+            key->direction = option->direction;
+            key->fontHeight = option->fontMetrics.height();
+            key->subControls = option->subControls;
+            switch (control) {
+            case QStyle::CC_ScrollBar:
+            case QStyle::CC_Slider: {
+                auto slider = qstyleoption_cast<const QStyleOptionSlider*>(option);
+                if (!slider)
+                    return false;
+                key->flags = slider->tickPosition << 1 | slider->upsideDown;
+                key->orientation = slider->orientation;
+                key->minimum = slider->minimum;
+                key->maximum = slider->maximum;
+                key->position = slider->sliderPosition;
+                key->pageStep = slider->pageStep;
+                key->singleStep = slider->singleStep;
+                return true;
+            }
+            case QStyle::CC_SpinBox: {
+                auto spinBox = qstyleoption_cast<const QStyleOptionSpinBox*>(option);
+                if (!spinBox)
+                    return false;
+                key->flags = spinBox->buttonSymbols << 1 | spinBox->frame;
+                return true;
+            }
+            case QStyle::CC_ComboBox: {
+                // The popup depends on the items, not just the option
+                auto comboBox = qstyleoption_cast<const QStyleOptionComboBox*>(option);
+                if (!comboBox || subControl == QStyle::SC_ComboBoxListBoxPopup)
+                    return false;
+                key->flags = comboBox->editable << 1 | comboBox->frame;
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        // Most recently used first
+        class GeometryCache
+        {
+        public:
+            const QRect* find(const GeometryCacheKey& key)
+            {
+                for (int i = 0; i < entries.size(); ++i) {
+                    if (entries.at(i).first == key) {
+                        std::rotate(entries.begin(), entries.begin() + i, entries.begin() + i + 1);
+                        return &entries[0].second;
+                    }
+                }
+                return nullptr;
+            }
+
+            void insert(const GeometryCacheKey& key, const QRect& rect)
+            {
+                if (entries.size() == GeometryCache_Size)
+                    entries.removeLast();
+                entries.prepend(qMakePair(key, rect));
+            }
+
+            void clear()
+            {
+                entries.clear();
+            }
+
+        private:
+            QVarLengthArray<QPair<GeometryCacheKey, QRect>, GeometryCache_Size> entries;
+        };
+
+        struct MenuItemMetrics
+        {
+            int fontHeight;
+            int frameThickness;
+            int leftMargin;
+            int rightMarginForText;
+            int rightMarginForArrow;
+            int topMargin;
+            int bottomMargin;
+            int checkWidth;
+            int checkRightSpace;
+            int iconRightSpace;
+            int mnemonicSpace;
+            int arrowSpace;
+            int arrowWidth;
+            int separatorHeight;
+            int totalHeight;
+
+            static MenuItemMetrics ofFontHeight(int fontHeight);
+
+        private:
+            MenuItemMetrics()
+            {
+            }
+        };
+
+        // Every font dependent metric of the style, derived once per font height
+        // instead of in every pixelMetric(), sizeFromContents() and paint call.
+        struct FontMetricTable
+        {
+            explicit FontMetricTable(int fontHeight);
+
+            int fontHeight;
+            int menuBarHMargin;
+            int tabBarTabHSpace;
+            int tabBarTabVSpace;
+            int groupBoxLabelBottomMargin;
+            int pushButtonHPad;
+            MenuItemMetrics menuItem;
+        };
+        constexpr int FontMetricTable_MaxEntries = 32;
+
+        // QWidget::fontMetrics() resolves the widget font against the logical DPI
+        // of its screen on every call, so the resulting height is remembered per
+        // (font, logical DPI, device pixel ratio) for the last few fonts.
+        struct WidgetFontHeight
+        {
+            QFont font;
+            int logicalDpi;
+            qreal devicePixelRatio;
+            int height;
+        };
+        constexpr int WidgetFontHeight_CacheSize = 8;
+
+        template <typename Compute>
+        QSize cachedSize(SizeCache* cache,
+                         const SizeCacheKey& key,
+                         const QFontMetrics& fontMetrics,
+                         const QString& text,
+                         Compute compute)
+        {
+            if (const SizeCacheEntry* entry = cache->object(key)) {
+                if (entry->fontMetrics == fontMetrics && entry->text == text)
+                    return entry->size;
+            }
+            const QSize size = compute();
+            cache->insert(key, new SizeCacheEntry{fontMetrics, text, size});
+            return size;
+        }
+
     } // namespace
 } // namespace Phantom
 
@@ -653,39 +1052,128 @@ class BaseStylePrivate
 public:
     BaseStylePrivate();
 
-    // A fast'n'easy hash of QPalette::cacheKey()+QPalette::currentColorGroup()
-    // of only the head element of swatchCache list. The most common thing that
-    // happens when deriving a PhSwatch from a QPalette is that we just end up
-    // re-using the last one that we used. For that case, we can potentially save
-    // calling `accurate_hash_qpalette()` and instead use the value returned by
-    // QPalette::cacheKey() (and QPalette::currentColorGroup()) and compare it to
-    // the last one that we used. If it matches, then we know we can just use the
-    // head of the cache list without having to do any further checks, which
-    // saves a few hundred (!) nanoseconds.
-    //
-    // However, the `QPalette::cacheKey()` value is fragile and may change even
-    // if none of the colors in the QPalette have changed. In other words, all of
-    // the colors in a QPalette may match another QPalette (or a derived
-    // PhSwatch) even if the `QPalette::cacheKey()` value is different.
-    //
-    // So if `QPalette::cacheKey()+currentColorGroup()` doesn't match, then we'll
-    // use our more accurate `accurate_hash_qpalette()` to get a more accurate
-    // comparison key, and then search through the cache list to find a matching
-    // cached PhSwatch. (The more accurate cache key is what we store alongside
-    // each PhSwatch element, as the `.first` in each QPair. The
-    // QPalette::cacheKey() that we associate with the PhSwatch in the head
-    // position, `headSwatchFastKey`, is only stored for our single head element,
-    // as a special fast case.) If we find it, we'll move it to the head of the
-    // cache list. If not, we'll make a new one, and put it at the head. Either
-    // way, the `headSwatchFastKey` will be updated to the
-    // `fastfragile_qpalette_hash()` of the QPalette that we needed to derive a
-    // PhSwatch from, so that if we get called with the same QPalette again next
-    // time (which is probably going to be the case), it'll match and we can take
-    // the fast path.
-    quint64 headSwatchFastKey;
-
-    Phantom::PhSwatchCache swatchCache;
-    QPen checkBox_pen_scratch;
+    // Everything the const drawing and measuring functions write to. The GUI
+    // thread always uses guiCaches; in thread-safe mode every other thread gets
+    // an instance of its own, see caches().
+    struct Caches
+    {
+        Caches();
+
+        // A fast'n'easy hash of QPalette::cacheKey()+QPalette::currentColorGroup()
+        // of only the head element of swatchCache list. The most common thing that
+        // happens when deriving a PhSwatch from a QPalette is that we just end up
+        // re-using the last one that we used. For that case, we can potentially save
+        // calling `accurate_hash_qpalette()` and instead use the value returned by
+        // QPalette::cacheKey() (and QPalette::currentColorGroup()) and compare it to
+        // the last one that we used. If it matches, then we know we can just use the
+        // head of the cache list without having to do any further checks, which
+        // saves a few hundred (!) nanoseconds.
+        //
+        // However, the `QPalette::cacheKey()` value is fragile and may change even
+        // if none of the colors in the QPalette have changed. In other words, all of
+        // the colors in a QPalette may match another QPalette (or a derived
+        // PhSwatch) even if the `QPalette::cacheKey()` value is different.
+        //
+        // So if `QPalette::cacheKey()+currentColorGroup()` doesn't match, then we'll
+        // use our more accurate `accurate_hash_qpalette()` to get a more accurate
+        // comparison key, and then search through the cache list to find a matching
+        // cached PhSwatch. (The more accurate cache key is what we store alongside
+        // each PhSwatch element, as the `.first` in each QPair. The
+        // QPalette::cacheKey() that we associate with the PhSwatch in the head
+        // position, `headSwatchFastKey`, is only stored for our single head element,
+        // as a special fast case.) If we find it, we'll move it to the head of the
+        // cache list. If not, we'll make a new one, and put it at the head. Either
+        // way, the `headSwatchFastKey` will be updated to the
+        // `fastfragile_qpalette_hash()` of the QPalette that we needed to derive a
+        // PhSwatch from, so that if we get called with the same QPalette again next
+        // time (which is probably going to be the case), it'll match and we can take
+        // the fast path.
+        quint64 headSwatchFastKey;
+
+        Phantom::PhSwatchCache swatchCache;
+        QPen checkBox_pen_scratch;
+
+        // Cleared whenever fonts or the style sheet change
+        Phantom::SizeCache sizeCache;
+        // Height of the per-class QMenu font used by combo box popups, -1 if unknown
+        int menuFontHeight;
+
+        Phantom::TextCache textCache;
+        Phantom::GeometryCache geometryCache;
+
+        // Font metric tables, see Phantom::FontMetricTable
+        QVarLengthArray<Phantom::WidgetFontHeight, Phantom::WidgetFontHeight_CacheSize> widgetFontHeights;
+        QHash<int, Phantom::FontMetricTable> fontMetricTables;
+
+        // BaseStylePrivate::cacheGeneration these caches are valid for
+        int generation;
+
+        Phantom::PhSwatchPtr swatch(const QPalette& palette)
+        {
+            return Phantom::getCachedSwatchOfQPalette(&swatchCache, &headSwatchFastKey, palette);
+        }
+
+        // Height of the widget's font on the widget's screen
+        int fontHeight(const QWidget* widget);
+        // The returned reference is only valid until the next call
+        const Phantom::FontMetricTable& metrics(int fontHeight);
+
+        // QFontMetrics::elidedText() of the painter's font, cached
+        QString elidedText(QPainter* painter, const QString& text, Qt::TextElideMode mode, int width);
+        // Draws single line text with a cached QStaticText if that looks the same as
+        // QPainter::drawText(rect, flags, text). Returns false without drawing otherwise.
+        bool drawStaticText(QPainter* painter, const QRect& rect, int flags, const QString& text);
+
+        void clear()
+        {
+            sizeCache.clear();
+            textCache.clear();
+            geometryCache.clear();
+            menuFontHeight = -1;
+            widgetFontHeights.clear();
+        }
+    };
+
+    Caches* caches();
+
+    bool isGuiThread() const
+    {
+        return QThread::currentThread() == guiThread;
+    }
+
+    // Rules of the application style sheet that are painted natively instead of
+    // being handed to Qt, see ThemeParams. The shipped sheet was written for the
+    // light palette, so they are not applied in dark mode.
+    ThemeParams::Rules themeRules;
+    bool lightTheme;
+
+    // What we last passed to QApplication::setStyleSheet()
+    QString appliedStyleSheet;
+    // Whether BaseStyle::applyFonts() has to follow application font changes
+    bool styleSheetFonts;
+
+    // generatedIconPixmap() results. Pixmaps belong to the GUI thread, so this
+    // one is not used from other threads.
+    Phantom::IconCache iconCache;
+
+    // PANDA_STYLE_THREADSAFE=1, see BaseStyle
+    bool threadSafe;
+    QThread* guiThread;
+    Caches guiCaches;
+    QThreadStorage<Caches*> threadCaches;
+    // Bumped on every invalidation, so other threads drop their caches as well
+    QAtomicInt cacheGeneration;
+
+    void invalidateMetricCaches()
+    {
+        guiCaches.clear();
+        cacheGeneration.ref();
+    }
+
+    bool hasThemeRule(ThemeParams::Rule rule) const
+    {
+        return lightTheme && themeRules.testFlag(rule);
+    }
 };
 
 namespace Phantom
@@ -760,32 +1248,6 @@ namespace Phantom
 #endif
         }
 
-        struct MenuItemMetrics
-        {
-            int fontHeight;
-            int frameThickness;
-            int leftMargin;
-            int rightMarginForText;
-            int rightMarginForArrow;
-            int topMargin;
-            int bottomMargin;
-            int checkWidth;
-            int checkRightSpace;
-            int iconRightSpace;
-            int mnemonicSpace;
-            int arrowSpace;
-            int arrowWidth;
-            int separatorHeight;
-            int totalHeight;
-
-            static MenuItemMetrics ofFontHeight(int fontHeight);
-
-        private:
-            MenuItemMetrics()
-            {
-            }
-        };
-
         MenuItemMetrics MenuItemMetrics::ofFontHeight(int fontHeight)
         {
             MenuItemMetrics m;
@@ -821,6 +1283,19 @@ namespace Phantom
             return m;
         }
 
+        FontMetricTable::FontMetricTable(int fontHeight_)
+            : fontHeight(fontHeight_),
+              menuBarHMargin(static_cast<int>(fontHeight_ * MenuBar_HorizontalPaddingFontRatio)),
+              tabBarTabHSpace(static_cast<int>(fontHeight_ * TabBar_HPaddingFontRatio)
+                              + static_cast<int>(dpiScaled(4))),
+              tabBarTabVSpace(static_cast<int>(fontHeight_ * TabBar_VPaddingFontRatio)
+                              + static_cast<int>(dpiScaled(2))),
+              groupBoxLabelBottomMargin(static_cast<int>(fontHeight_ * GroupBox_LabelBottomMarginFontRatio)),
+              pushButtonHPad(static_cast<int>(fontHeight_ * PushButton_HorizontalPaddingFontHeightRatio)),
+              menuItem(MenuItemMetrics::ofFontHeight(fontHeight_))
+        {
+        }
+
         QRect menuItemContentRect(const MenuItemMetrics& metrics, QRect itemRect, bool hasArrow)
         {
             QRect r = itemRect;
@@ -1060,12 +1535,126 @@ namespace Phantom
 #endif
         }
 
+        // Pre-rendered indicators. Check boxes, radio buttons, check marks and
+        // arrows are antialiased ellipses and paths that are slow to rasterize, and
+        // checkable item views paint the same few of them thousands of times. Each
+        // distinct (type, size, variant, colors, device pixel ratio) is rendered
+        // once into an image and blitted from then on.
+        enum IndicatorType
+        {
+            Indicator_CheckBox = 1,
+            Indicator_RadioButton,
+            Indicator_CheckMark,
+            Indicator_Arrow,
+        };
+        // Larger indicators are rare and would only push the common ones out
+        constexpr int IndicatorAtlas_MaxExtent = 64;
+        constexpr int IndicatorAtlas_MaxCostKiB = 2048;
+
+        // Only plain ints, so it can be hashed and compared bytewise.
+        struct IndicatorKey
+        {
+            IndicatorKey(IndicatorType type_, QSize size, int variant_)
+                : type(type_), width(size.width()), height(size.height()), variant(variant_)
+            {
+            }
+
+            int type;
+            int width;
+            int height;
+            int variant;
+            int devicePixelRatio = 0; // in percent
+            QRgb colors[4] = {};
+
+            bool operator==(const IndicatorKey& other) const
+            {
+                return memcmp(this, &other, sizeof(IndicatorKey)) == 0;
+            }
+        };
+
+        inline uint qHash(const IndicatorKey& key, uint seed = 0)
+        {
+            return qHashBits(&key, sizeof(IndicatorKey), seed);
+        }
+
+        // Shared by all styles and threads. Lookups only take the read lock; an
+        // atlas that runs over its budget simply starts over, indicators are cheap
+        // to render again.
+        class IndicatorAtlas
+        {
+        public:
+            // Paints the indicator with paint(painter, rect), from the atlas if a blit
+            // gives the same pixels as painting directly, and directly otherwise.
+            template <typename Paint>
+            void draw(QPainter* painter, const QRect& rect, IndicatorKey key, Paint paint)
+            {
+                const qreal dpr = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+                if (!canBlit(painter, rect, dpr)) {
+                    paint(painter, rect);
+                    return;
+                }
+                key.devicePixelRatio = qRound(dpr * 100);
+                QImage image;
+                {
+                    QReadLocker locker(&lock);
+                    image = images.value(key);
+                }
+                PaintProfiler::count(image.isNull() ? PaintProfiler::IndicatorAtlasMiss : PaintProfiler::IndicatorAtlasHit);
+                if (image.isNull()) {
+                    image = QImage(qCeil(rect.width() * dpr), qCeil(rect.height() * dpr), QImage::Format_ARGB32_Premultiplied);
+                    image.setDevicePixelRatio(dpr);
+                    image.fill(Qt::transparent);
+                    {
+                        QPainter imagePainter(&image);
+                        paint(&imagePainter, QRect(QPoint(0, 0), rect.size()));
+                    }
+                    const int cost = qMax(1, image.bytesPerLine() * image.height() / 1024);
+                    QWriteLocker locker(&lock);
+                    if (totalCost + cost > IndicatorAtlas_MaxCostKiB) {
+                        images.clear();
+                        totalCost = 0;
+                    }
+                    if (!images.contains(key)) {
+                        images.insert(key, image);
+                        totalCost += cost;
+                    }
+                }
+                painter->drawImage(rect.topLeft(), image);
+            }
+
+        private:
+            static bool canBlit(QPainter* painter, const QRect& rect, qreal dpr)
+            {
+                if (rect.isEmpty() || rect.width() > IndicatorAtlas_MaxExtent || rect.height() > IndicatorAtlas_MaxExtent)
+                    return false;
+                if (painter->opacity() < 1.0 || painter->compositionMode() != QPainter::CompositionMode_SourceOver)
+                    return false;
+                // Only whole device pixel translations, anything else would resample
+                const QTransform& transform = painter->worldTransform();
+                if (transform.type() > QTransform::TxTranslate)
+                    return false;
+                const qreal x = (rect.x() + transform.dx()) * dpr;
+                const qreal y = (rect.y() + transform.dy()) * dpr;
+                return qFuzzyIsNull(x - std::round(x)) && qFuzzyIsNull(y - std::round(y));
+            }
+
+            QReadWriteLock lock;
+            QHash<IndicatorKey, QImage> images;
+            int totalCost = 0;
+        };
+
+        IndicatorAtlas* indicatorAtlas()
+        {
+            static IndicatorAtlas atlas;
+            return &atlas;
+        }
+
         // This always draws the arrow with the correct aspect ratio, even if the
         // provided bounding rect is non-square. The base edge of the triangle is
         // snapped to a whole pixel to avoid anti-aliasing making it look soft.
         //
         // Expected time (release): 5usecs for regular-sized arrows
-        Q_NEVER_INLINE void drawArrow(QPainter* p, QRect rect, Qt::ArrowType arrowDirection, const QBrush& brush)
+        Q_NEVER_INLINE void drawArrowDirect(QPainter* p, QRect rect, Qt::ArrowType arrowDirection, const QBrush& brush)
         {
             const qreal ArrowBaseRatio = 0.70;
             qreal irx, iry, irw, irh;
@@ -1132,6 +1721,20 @@ namespace Phantom
             }
         }
 
+        Q_NEVER_INLINE void drawArrow(QPainter* p, QRect rect, Qt::ArrowType arrowDirection, const QBrush& brush)
+        {
+            // Gradients and textures depend on where they are painted
+            if (brush.style() != Qt::SolidPattern) {
+                drawArrowDirect(p, rect, arrowDirection, brush);
+                return;
+            }
+            IndicatorKey key(Indicator_Arrow, rect.size(), arrowDirection);
+            key.colors[0] = brush.color().rgba();
+            indicatorAtlas()->draw(p, rect, key, [&](QPainter* painter, const QRect& r) {
+                drawArrowDirect(painter, r, arrowDirection, brush);
+            });
+        }
+
         // Pass allowEnabled as false to always draw the arrow with the disabled color,
         // even if the underlying palette's current color group is not disabled. Useful
         // for parts of widgets which may want to be drawn as disabled even if the
@@ -1405,21 +2008,285 @@ namespace Phantom
                 }
             }
         }
+        // Transitions are kept per widget, so only a button painting itself gets
+        // one. Item delegates and custom controls paint many buttons through a
+        // single widget, and those change state at once.
+        const QWidget* animatedButton(const QStyleOption* option, const QWidget* widget)
+        {
+            return qobject_cast<const QAbstractButton*>(widget) && option->rect == widget->rect() ? widget : nullptr;
+        }
+        // Widgets of the panda applications that the shipped style sheet names
+        bool isSearchField(const QWidget* widget)
+        {
+            return qobject_cast<const QLineEdit*>(widget) && widget->objectName() == QLatin1String("actionSearch");
+        }
+        bool isCompleterPopup(const QWidget* widget)
+        {
+            return qobject_cast<const QListView*>(widget)
+                   && widget->objectName() == QLatin1String("actionCompleterPopup");
+        }
+        bool isMainMenuBar(const QWidget* widget)
+        {
+            return widget && widget->inherits("MainWindow") && widget->objectName() == QLatin1String("menuBar");
+        }
+        // A menu popup is sized to fit every item, so QComboBox lays out and
+        // measures all rows before it opens, which takes seconds for font
+        // pickers and time zone lists. Past ComboBoxMenuPopup_MaxItems the combo
+        // drops down its list view instead, which only measures the rows it
+        // shows, and the view is told that all rows are as tall as the first.
+        // Kept up to date with the row count by watchComboBoxModel(), so
+        // SH_ComboBox_Popup itself only reads the result.
+        Q_NEVER_INLINE void updateComboBoxPopup(QComboBox* combo)
+        {
+            const char* listPopupProperty = "_panda_list_popup";
+            const bool listPopup = UseQMenuForComboBoxPopup && combo->count() > ComboBoxMenuPopup_MaxItems;
+            if (listPopup == combo->property(listPopupProperty).toBool())
+                return;
+
+            // Creating the view while the hint still asks for a menu gives the
+            // combo its QComboMenuDelegate, which QComboBox would replace with a
+            // plain item delegate once the hint changes. Ours paints the same
+            // menu items and is left alone.
+            if (listPopup && combo->itemDelegate()->inherits("QComboMenuDelegate"))
+                combo->setItemDelegate(new ComboBoxMenuDelegate(combo));
+            combo->setProperty(listPopupProperty, listPopup);
+
+            if (auto listView = qobject_cast<QListView*>(combo->view())) {
+                // Only undo uniform item sizes that we turned on ourselves
+                const char* uniformProperty = "_panda_uniform_item_sizes";
+                if (listPopup && !listView->uniformItemSizes()) {
+                    listView->setUniformItemSizes(true);
+                    listView->setProperty(uniformProperty, true);
+                } else if (!listPopup && listView->property(uniformProperty).toBool()) {
+                    listView->setUniformItemSizes(false);
+                    listView->setProperty(uniformProperty, QVariant());
+                }
+            }
+        }
+        const char* const ComboBoxModelWatcherName = "_panda_model_watcher";
+        // Runs updateComboBoxPopup() whenever rows of the combo's model come or
+        // go, so popups opened by showPopup() alone get the right kind too.
+        // QComboBox has no signal for a new model, so this is called again on
+        // show and on the presses that open the popup.
+        void watchComboBoxModel(QComboBox* combo)
+        {
+            QAbstractItemModel* model = combo->model();
+            QObject* watcher = combo->findChild<QObject*>(QLatin1String(ComboBoxModelWatcherName),
+                                                          Qt::FindDirectChildrenOnly);
+            if (!watcher || qvariant_cast<QObject*>(watcher->property("_panda_model")) != model) {
+                // The connections go away with the watcher, QComboBox's own stay
+                delete watcher;
+                watcher = new QObject(combo);
+                watcher->setObjectName(QLatin1String(ComboBoxModelWatcherName));
+                watcher->setProperty("_panda_model", QVariant::fromValue<QObject*>(model));
+                auto update = [combo] { updateComboBoxPopup(combo); };
+                QObject::connect(model, &QAbstractItemModel::rowsInserted, watcher, update);
+                QObject::connect(model, &QAbstractItemModel::rowsRemoved, watcher, update);
+                QObject::connect(model, &QAbstractItemModel::modelReset, watcher, update);
+            }
+            updateComboBoxPopup(combo);
+        }
+        void unwatchComboBoxModel(QComboBox* combo)
+        {
+            delete combo->findChild<QObject*>(QLatin1String(ComboBoxModelWatcherName), Qt::FindDirectChildrenOnly);
+        }
     } // namespace
 } // namespace Phantom
 
+int BaseStylePrivate::Caches::fontHeight(const QWidget* widget)
+{
+    const QFont& font = widget->font();
+    // Screens can differ in logical DPI at the same device pixel ratio
+    const int logicalDpi = widget->logicalDpiY();
+    const qreal devicePixelRatio = widget->devicePixelRatioF();
+    for (int i = 0; i < widgetFontHeights.size(); ++i) {
+        const Phantom::WidgetFontHeight& entry = widgetFontHeights.at(i);
+        if (entry.logicalDpi == logicalDpi && entry.devicePixelRatio == devicePixelRatio && entry.font == font) {
+            const int height = entry.height;
+            // Keep the most recently used font in front
+            std::rotate(widgetFontHeights.begin(), widgetFontHeights.begin() + i, widgetFontHeights.begin() + i + 1);
+            return height;
+        }
+    }
+    const int height = widget->fontMetrics().height();
+    if (widgetFontHeights.size() == Phantom::WidgetFontHeight_CacheSize)
+        widgetFontHeights.removeLast();
+    widgetFontHeights.prepend(Phantom::WidgetFontHeight{font, logicalDpi, devicePixelRatio, height});
+    return height;
+}
+
+const Phantom::FontMetricTable& BaseStylePrivate::Caches::metrics(int fontHeight)
+{
+    auto it = fontMetricTables.constFind(fontHeight);
+    if (it != fontMetricTables.constEnd())
+        return it.value();
+    if (fontMetricTables.size() >= Phantom::FontMetricTable_MaxEntries)
+        fontMetricTables.clear();
+    return fontMetricTables.insert(fontHeight, Phantom::FontMetricTable(fontHeight)).value();
+}
+
+QString BaseStylePrivate::Caches::elidedText(QPainter* painter, const QString& text, Qt::TextElideMode mode, int width)
+{
+    const QFont& font = painter->font();
+    Phantom::TextCacheKey key;
+    key.kind = Phantom::TextCache_Elided;
+    key.fontHash = qHash(font);
+    key.dpi = painter->device() ? painter->device()->logicalDpiY() : 0;
+    key.textHash = qHash(text);
+    key.width = width;
+    key.flags = mode;
+    if (const Phantom::TextCacheEntry* entry = textCache.object(key)) {
+        if (entry->font == font && entry->text == text)
+            return entry->elidedText;
+    }
+    const QString elided = painter->fontMetrics().elidedText(text, mode, width);
+    textCache.insert(key, new Phantom::TextCacheEntry{font, text, elided, QStaticText()});
+    return elided;
+}
+
+bool BaseStylePrivate::Caches::drawStaticText(QPainter* painter, const QRect& rect, int flags, const QString& text)
+{
+    // Multiple lines, tabs, visible mnemonics and mirrored alignment are left to
+    // QPainter::drawText()
+    if (painter->layoutDirection() == Qt::RightToLeft && !(flags & Qt::AlignAbsolute))
+        return false;
+    if (flags & (Qt::TextExpandTabs | Qt::TextJustificationForced))
+        return false;
+    for (const QChar c : text) {
+        if (c == QLatin1Char('\n') || c == QLatin1Char('\t') || c == QChar::LineSeparator)
+            return false;
+        if (c == QLatin1Char('&') && (flags & Qt::TextShowMnemonic) && !(flags & Qt::TextHideMnemonic))
+            return false;
+    }
+
+    const QFont& font = painter->font();
+    Phantom::TextCacheKey key;
+    key.kind = Phantom::TextCache_Static;
+    key.fontHash = qHash(font);
+    key.dpi = painter->device() ? painter->device()->logicalDpiY() : 0;
+    key.textHash = qHash(text);
+    key.flags = flags & (Qt::TextShowMnemonic | Qt::TextHideMnemonic);
+    const Phantom::TextCacheEntry* entry = textCache.object(key);
+    if (!entry || entry->font != font || entry->text != text) {
+        const bool stripMnemonics = flags & (Qt::TextShowMnemonic | Qt::TextHideMnemonic);
+        QStaticText staticText(stripMnemonics ? Phantom::removeMnemonics(text) : text);
+        staticText.setTextFormat(Qt::PlainText);
+        staticText.prepare(QTransform(), font);
+        auto newEntry = new Phantom::TextCacheEntry{font, text, QString(), staticText};
+        if (!textCache.insert(key, newEntry))
+            return false;
+        entry = newEntry;
+    }
+
+    // Text that doesn't fit would be clipped by drawText()
+    const QSizeF size = entry->staticText.size();
+    if (!(flags & Qt::TextDontClip) && (size.width() > rect.width() || size.height() > rect.height()))
+        return false;
+
+    qreal x = rect.x();
+    qreal y = rect.y();
+    if (flags & Qt::AlignRight)
+        x += rect.width() - size.width();
+    else if (flags & Qt::AlignHCenter)
+        x += (rect.width() - size.width()) / 2;
+    if (flags & Qt::AlignBottom)
+        y += rect.height() - size.height();
+    else if (flags & Qt::AlignVCenter)
+        y += (rect.height() - size.height()) / 2;
+    painter->drawStaticText(QPointF(x, y), entry->staticText);
+    return true;
+}
+
+BaseStylePrivate::Caches::Caches()
+    : headSwatchFastKey(0),
+      sizeCache(Phantom::SizeCache_MaxEntries),
+      menuFontHeight(-1),
+      textCache(Phantom::TextCache_MaxEntries),
+      generation(0)
+{
+}
+
 BaseStylePrivate::BaseStylePrivate()
-    : headSwatchFastKey(0)
+    : themeRules(ThemeParams::NoRules),
+      lightTheme(true),
+      styleSheetFonts(false),
+      iconCache(Phantom::IconCache_MaxCostKiB),
+      threadSafe(qEnvironmentVariable("PANDA_STYLE_THREADSAFE") == QLatin1String("1")),
+      guiThread(QThread::currentThread())
+{
+}
+
+BaseStylePrivate::Caches* BaseStylePrivate::caches()
 {
+    if (Q_LIKELY(!threadSafe) || isGuiThread())
+        return &guiCaches;
+
+    Caches* local = threadCaches.localData();
+    if (!local) {
+        local = new Caches;
+        threadCaches.setLocalData(local);
+    }
+    const int generation = cacheGeneration.loadAcquire();
+    if (local->generation != generation) {
+        local->clear();
+        local->generation = generation;
+    }
+    return local;
 }
 
 BaseStyle::BaseStyle()
     : d(new BaseStylePrivate),
-      m_shadowHelper(new ShadowHelper(this))
+      m_shadowHelper(new ShadowHelper(this)),
+      m_polishHelper(nullptr),
+      m_styleSheetLoader(new StyleSheetLoader(this)),
+      m_animationEngine(new AnimationEngine(this)),
+      m_prewarmScheduler(new PrewarmScheduler(this)),
+      m_darkMode(false)
 {
     setObjectName(QLatin1String("Phantom"));
 
+    // Start in the mode the platform theme is in, it publishes it next to
+    // _panda_style_object and only calls setDarkMode() for changes
+    if (QCoreApplication *app = QCoreApplication::instance())
+        m_darkMode = app->property("_panda_dark_mode").toBool();
+    d->lightTheme = !m_darkMode;
+
     m_shadowHelper->setFrameRadius(Phantom::DefaultFrame_Radius);
+
+    // PANDA_STYLE_PROFILE=1 counts and times what gets painted
+    PaintProfiler::createIfEnabled(this);
+
+    if (qGuiApp) {
+        connect(qGuiApp, &QGuiApplication::fontChanged, this, [this] {
+            d->invalidateMetricCaches();
+            // The platform theme drops the application font on a system font
+            // change, and the per-class fonts still have the old family
+            if (d->styleSheetFonts && qApp && qvariant_cast<QObject*>(qApp->property("_panda_style_object")) == this)
+                applyFonts(qApp);
+        });
+    }
+
+    // Live reload of the style sheet file
+    connect(m_styleSheetLoader, &StyleSheetLoader::styleSheetChanged, this, [this] {
+        if (!qApp || qvariant_cast<QObject*>(qApp->property("_panda_style_object")) != this)
+            return;
+        const ThemeParams::Rules themeRules = d->themeRules;
+        applyStyleSheet(qApp);
+        if (d->themeRules != themeRules) {
+            qApp->setPalette(standardPalette());
+            const QWidgetList widgets = QApplication::allWidgets();
+            for (QWidget *widget : widgets)
+                widget->update();
+        }
+    });
+
+    // Alerts should not wait for the sound file to be found and decoded
+    sound::preload(QStringLiteral("ping.wav"));
+
+    // PANDA_DEFERRED_POLISH=0 restores polishing everything as soon as Qt asks
+    if (qEnvironmentVariable("PANDA_DEFERRED_POLISH") != QLatin1String("0")) {
+        m_polishHelper = new PolishHelper([this](QWidget *widget) { polishDeferred(widget); }, this);
+    }
 }
 
 BaseStyle::~BaseStyle()
@@ -1444,7 +2311,8 @@ void BaseStyle::drawItemText(QPainter* painter,
     if (text.isEmpty())
         return;
     if (textRole == QPalette::NoRole) {
-        painter->drawText(rect, alignment, text);
+        if (!d->caches()->drawStaticText(painter, rect, alignment, text))
+            painter->drawText(rect, alignment, text);
         return;
     }
     QPen savedPen = painter->pen();
@@ -1456,7 +2324,8 @@ void BaseStyle::drawItemText(QPainter* painter,
     }
     QRect modifiedRect = rect;
     modifiedRect.setY(rect.y()+1); // probono: Forcefully push down the text in the menu bar by 1px; https://github.com/helloSystem/Menu/issues/66
-    painter->drawText(modifiedRect, alignment, text); // probono: This is what draws text in the menu bar
+    if (!d->caches()->drawStaticText(painter, modifiedRect, alignment, text))
+        painter->drawText(modifiedRect, alignment, text); // probono: This is what draws text in the menu bar
     if (changed) {
         painter->setPen(savedPen);
     }
@@ -1475,10 +2344,11 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
     const char* elemCString = QMetaEnum::fromType<QStyle::PrimitiveElement>().valueToKey(elem);
     EASY_TEXT("Element", elemCString);
 #endif
+    PaintProfiler::Scope profilerScope(PaintProfiler::Primitive, elem);
     using Swatchy = Phantom::Swatchy;
     using namespace Phantom::SwatchColors;
     namespace Ph = Phantom;
-    auto ph_swatchPtr = getCachedSwatchOfQPalette(&d->swatchCache, &d->headSwatchFastKey, option->palette);
+    auto ph_swatchPtr = d->caches()->swatch(option->palette);
     const Ph::PhSwatch& swatch = *ph_swatchPtr.data();
     const int state = option->state;
     // Cast to int here to suppress warnings about cases listed which are not in
@@ -1577,14 +2447,18 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         } else if (!isEnabled) {
             fgColor = S_windowText_disabled;
         }
-        qreal rx, ry, rw, rh;
-        QRectF(option->rect).getRect(&rx, &ry, &rw, &rh);
-        qreal dim = qMin(rw, rh);
-        const qreal insetScale = 0.8;
-        qreal dimx = dim * insetScale * Ph::CheckMark_WidthOfHeightScale;
-        qreal dimy = dim * insetScale;
-        QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
-        Ph::drawCheck(painter, d->checkBox_pen_scratch, r_, swatch, fgColor);
+        Ph::IndicatorKey key(Ph::Indicator_CheckMark, option->rect.size(), 0);
+        key.colors[0] = swatch.color(fgColor).rgba();
+        Ph::indicatorAtlas()->draw(painter, option->rect, key, [&](QPainter* p, const QRect& rect) {
+            qreal rx, ry, rw, rh;
+            QRectF(rect).getRect(&rx, &ry, &rw, &rh);
+            qreal dim = qMin(rw, rh);
+            const qreal insetScale = 0.8;
+            qreal dimx = dim * insetScale * Ph::CheckMark_WidthOfHeightScale;
+            qreal dimy = dim * insetScale;
+            QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
+            Ph::drawCheck(p, d->caches()->checkBox_pen_scratch, r_, swatch, fgColor);
+        });
         break;
     }
     case PE_PanelTipLabel: {
@@ -1606,6 +2480,17 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
     }
         // Called for the content area on tree view rows that are selected
     case PE_PanelItemViewItem: {
+        // Painted rather than put into the palette, so it follows dark mode switches
+        if (d->hasThemeRule(ThemeParams::CompleterPopupRule) && Ph::isCompleterPopup(widget)) {
+            auto vopt = qstyleoption_cast<const QStyleOptionViewItem*>(option);
+            if (option->state & State_Selected)
+                painter->fillRect(option->rect, ThemeParams::gradient(option->rect, ThemeParams::menuSelectedStops));
+            else if (!vopt || vopt->backgroundBrush.style() == Qt::NoBrush)
+                painter->fillRect(option->rect, ThemeParams::completerPopupBackground);
+            else
+                QCommonStyle::drawPrimitive(elem, option, painter, widget);
+            break;
+        }
         QCommonStyle::drawPrimitive(elem, option, painter, widget);
         break;
     }
@@ -1841,6 +2726,12 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         auto panel = qstyleoption_cast<const QStyleOptionFrame*>(option);
         if (!panel)
             break;
+        if (d->hasThemeRule(ThemeParams::SearchFieldRule) && Ph::isSearchField(widget)) {
+            // Transparent and borderless, filled like a selected menu item while focused
+            if ((option->state & State_HasFocus) && d->hasThemeRule(ThemeParams::SearchFieldFocusRule))
+                painter->fillRect(option->rect, ThemeParams::gradient(option->rect, ThemeParams::menuSelectedStops));
+            break;
+        }
         Ph::PSave save(painter);
         // We intentionally don't inset the fill rect, even if the frame will paint
         // over the perimeter, because an inset with rounding enabled may cause
@@ -1881,70 +2772,88 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         if (isSelected && isFlat) {
             fgColor = S_highlightedText;
         }
-        if (!isFlat) {
-            QRect fillR = r;
-            Ph::fillRectOutline(painter, fillR, 1, swatch.color(outlineColor));
-            fillR.adjust(1, 1, -1, -1);
-            if (Ph::IndicatorShadows && !isPressed && isEnabled) {
-                Ph::fillRectEdges(painter, fillR, Qt::TopEdge, 1, swatch.color(S_base_shadow));
-                fillR.adjust(0, 1, 0, 0);
+        const bool hasShadow = Ph::IndicatorShadows && !isPressed && isEnabled;
+        const int checkState = checkbox->state & State_NoChange ? 2 : checkbox->state & State_On ? 1 : 0;
+        Ph::IndicatorKey key(Ph::Indicator_CheckBox, r.size(), checkState | isFlat << 2 | hasShadow << 3);
+        key.colors[0] = swatch.color(outlineColor).rgba();
+        key.colors[1] = swatch.color(S_base_shadow).rgba();
+        key.colors[2] = swatch.color(bgFillColor).rgba();
+        key.colors[3] = swatch.color(fgColor).rgba();
+        Ph::indicatorAtlas()->draw(painter, r, key, [&](QPainter* p, const QRect& rect) {
+            if (!isFlat) {
+                QRect fillR = rect;
+                Ph::fillRectOutline(p, fillR, 1, swatch.color(outlineColor));
+                fillR.adjust(1, 1, -1, -1);
+                if (hasShadow) {
+                    Ph::fillRectEdges(p, fillR, Qt::TopEdge, 1, swatch.color(S_base_shadow));
+                    fillR.adjust(0, 1, 0, 0);
+                }
+                p->fillRect(fillR, swatch.color(bgFillColor));
             }
-            painter->fillRect(fillR, swatch.color(bgFillColor));
-        }
-        if (checkbox->state & State_NoChange) {
-            const qreal insetScale = 0.7;
-            qreal rx, ry, rw, rh;
-            QRectF(r.adjusted(1, 1, -1, -1)).getRect(&rx, &ry, &rw, &rh);
-            qreal dimx = rw * insetScale;
-            qreal dimy = rh * insetScale;
-            QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
-            Ph::drawHyphen(painter, d->checkBox_pen_scratch, r_, swatch, fgColor);
-        } else if (checkbox->state & State_On) {
-            const qreal insetScale = 0.8;
-            qreal rx, ry, rw, rh;
-            QRectF(r.adjusted(1, 1, -1, -1)).getRect(&rx, &ry, &rw, &rh);
-            // kinda wrong, assumes we're already square, but we probably are
-            qreal dimx = rw * insetScale * Ph::CheckMark_WidthOfHeightScale;
-            qreal dimy = rh * insetScale;
-            QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
-            Ph::drawCheck(painter, d->checkBox_pen_scratch, r_, swatch, fgColor);
-        }
+            if (checkState == 2) {
+                const qreal insetScale = 0.7;
+                qreal rx, ry, rw, rh;
+                QRectF(rect.adjusted(1, 1, -1, -1)).getRect(&rx, &ry, &rw, &rh);
+                qreal dimx = rw * insetScale;
+                qreal dimy = rh * insetScale;
+                QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
+                Ph::drawHyphen(p, d->caches()->checkBox_pen_scratch, r_, swatch, fgColor);
+            } else if (checkState == 1) {
+                const qreal insetScale = 0.8;
+                qreal rx, ry, rw, rh;
+                QRectF(rect.adjusted(1, 1, -1, -1)).getRect(&rx, &ry, &rw, &rh);
+                // kinda wrong, assumes we're already square, but we probably are
+                qreal dimx = rw * insetScale * Ph::CheckMark_WidthOfHeightScale;
+                qreal dimy = rh * insetScale;
+                QRectF r_(rx + (rw - dimx) / 2, ry + (rh - dimy) / 2, dimx, dimy);
+                Ph::drawCheck(p, d->caches()->checkBox_pen_scratch, r_, swatch, fgColor);
+            }
+        });
         break;
     }
     case PE_IndicatorRadioButton: {
-        qreal rx, ry, rw, rh;
-        QRectF(option->rect).getRect(&rx, &ry, &rw, &rh);
         bool isHighlighted = option->state & State_HasFocus && option->state & State_KeyboardFocusChange;
         bool isSunken = state & State_Sunken;
         bool isEnabled = state & State_Enabled;
+        bool isOn = state & State_On;
         Swatchy outlineColor = isHighlighted ? S_highlight_outline : S_window_outline;
         Swatchy bgFillColor = isSunken ? S_highlight : S_base;
-        QPointF circleCenter(rx + rw / 2.0, ry + rh / 2.0);
-        const qreal lineThickness = 1.0;
-        qreal outlineRadius = (qMin(rw, rh) - lineThickness) / 2.0;
-        qreal fillRadius = outlineRadius - lineThickness / 2.0;
-        Ph::PSave save(painter);
-        painter->setRenderHint(QPainter::Antialiasing);
-        painter->setBrush(swatch.brush(bgFillColor));
-        painter->setPen(swatch.pen(outlineColor));
-        painter->drawEllipse(circleCenter, outlineRadius, outlineRadius);
-        if (Ph::IndicatorShadows && !isSunken && isEnabled) {
-            // Really slow, just a temp demo test
-            painter->setPen(Qt::NoPen);
-            painter->setBrush(swatch.brush(S_base_shadow));
-            QPainterPath path0, path1;
-            path0.addEllipse(circleCenter, fillRadius, fillRadius);
-            path1.addEllipse(circleCenter + QPointF(0, 1.25), fillRadius, fillRadius);
-            QPainterPath path2 = path0 - path1;
-            painter->drawPath(path2);
-        }
-        if (state & State_On) {
-            Swatchy fgColor = isSunken ? S_highlightedText : S_windowText;
-            qreal checkmarkRadius = outlineRadius / 2.32;
-            painter->setPen(Qt::NoPen);
-            painter->setBrush(swatch.brush(fgColor));
-            painter->drawEllipse(circleCenter, checkmarkRadius, checkmarkRadius);
-        }
+        Swatchy fgColor = isSunken ? S_highlightedText : S_windowText;
+        const bool hasShadow = Ph::IndicatorShadows && !isSunken && isEnabled;
+        Ph::IndicatorKey key(Ph::Indicator_RadioButton, option->rect.size(), isOn | hasShadow << 1);
+        key.colors[0] = swatch.color(outlineColor).rgba();
+        key.colors[1] = swatch.color(S_base_shadow).rgba();
+        key.colors[2] = swatch.color(bgFillColor).rgba();
+        key.colors[3] = swatch.color(fgColor).rgba();
+        Ph::indicatorAtlas()->draw(painter, option->rect, key, [&](QPainter* p, const QRect& rect) {
+            qreal rx, ry, rw, rh;
+            QRectF(rect).getRect(&rx, &ry, &rw, &rh);
+            QPointF circleCenter(rx + rw / 2.0, ry + rh / 2.0);
+            const qreal lineThickness = 1.0;
+            qreal outlineRadius = (qMin(rw, rh) - lineThickness) / 2.0;
+            qreal fillRadius = outlineRadius - lineThickness / 2.0;
+            Ph::PSave save(p);
+            p->setRenderHint(QPainter::Antialiasing);
+            p->setBrush(swatch.brush(bgFillColor));
+            p->setPen(swatch.pen(outlineColor));
+            p->drawEllipse(circleCenter, outlineRadius, outlineRadius);
+            if (hasShadow) {
+                // Really slow, just a temp demo test
+                p->setPen(Qt::NoPen);
+                p->setBrush(swatch.brush(S_base_shadow));
+                QPainterPath path0, path1;
+                path0.addEllipse(circleCenter, fillRadius, fillRadius);
+                path1.addEllipse(circleCenter + QPointF(0, 1.25), fillRadius, fillRadius);
+                QPainterPath path2 = path0 - path1;
+                p->drawPath(path2);
+            }
+            if (isOn) {
+                qreal checkmarkRadius = outlineRadius / 2.32;
+                p->setPen(Qt::NoPen);
+                p->setBrush(swatch.brush(fgColor));
+                p->drawEllipse(circleCenter, checkmarkRadius, checkmarkRadius);
+            }
+        });
         break;
     }
     case PE_IndicatorToolBarHandle: {
@@ -2086,16 +2995,41 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         if (isFlat && !isDown && !isOn)
             break;
         bool isEnabled = option->state & State_Enabled;
-        Q_UNUSED(isEnabled);
+        if (d->hasThemeRule(ThemeParams::ButtonRule) && qobject_cast<const QPushButton*>(widget)) {
+            // Later rules of the shipped sheet win: hover over default over plain
+            const QGradientStops* stops = &ThemeParams::buttonStops;
+            if (isDefault && d->hasThemeRule(ThemeParams::DefaultButtonRule))
+                stops = &ThemeParams::defaultButtonStops;
+            qreal hover = 0.0;
+            if (d->hasThemeRule(ThemeParams::HoverButtonRule)) {
+                const bool isHover = isDown || (isEnabled && option->state & State_MouseOver);
+                hover = m_animationEngine->value(
+                    Ph::animatedButton(option, widget), SC_None, AnimationEngine::Hover, isHover, option->rect);
+            }
+            const QRectF r = strokedRect(option->rect, 1);
+            const qreal radius = qMin<qreal>(ThemeParams::buttonRadius, r.height() / 2);
+            Ph::PSave save(painter);
+            painter->setRenderHint(QPainter::Antialiasing);
+            painter->setPen(ThemeParams::buttonBorder);
+            if (hover < 1.0) {
+                painter->setBrush(ThemeParams::gradient(r, *stops));
+                painter->drawRoundedRect(r, radius, radius);
+            }
+            if (hover > 0.0) {
+                const qreal opacity = painter->opacity();
+                painter->setOpacity(opacity * hover);
+                painter->setBrush(ThemeParams::gradient(r, ThemeParams::hoverButtonStops));
+                painter->drawRoundedRect(r, radius, radius);
+                painter->setOpacity(opacity);
+            }
+            break;
+        }
         bool hasFocus = (option->state & State_HasFocus && option->state & State_KeyboardFocusChange);
         const qreal rounding = option->rect.height() / 2 ; // probono: was: Ph::PushButton_Rounding;
         Swatchy outline = S_window_outline;
         Swatchy fill = S_button;
         Swatchy specular = S_button_specular;
-        if (isDown) {
-            fill = S_button_pressed;
-            specular = S_button_pressed_specular;
-        } else if (isOn) {
+        if (isOn) {
             // kinda repurposing this, hmm
             fill = S_scrollbarGutter;
             specular = S_button_pressed_specular;
@@ -2103,10 +3037,23 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         if (hasFocus || isDefault) {
             outline = S_highlight_outline;
         }
+        const qreal press = m_animationEngine->value(
+            Ph::animatedButton(option, widget), SC_None, AnimationEngine::Press, isDown, option->rect);
         QRect r = option->rect;
         Ph::PSave save(painter);
-        Ph::paintBorderedRoundRect(painter, r, rounding, swatch, outline, fill);
-        Ph::paintBorderedRoundRect(painter, r.adjusted(1, 1, -1, -1), rounding - 1, swatch, specular, S_none);
+        if (press < 1.0) {
+            Ph::paintBorderedRoundRect(painter, r, rounding, swatch, outline, fill);
+            Ph::paintBorderedRoundRect(painter, r.adjusted(1, 1, -1, -1), rounding - 1, swatch, specular, S_none);
+        }
+        if (press > 0.0) {
+            // The pressed look fades in over the released one
+            const qreal opacity = painter->opacity();
+            painter->setOpacity(opacity * press);
+            Ph::paintBorderedRoundRect(painter, r, rounding, swatch, outline, S_button_pressed);
+            Ph::paintBorderedRoundRect(
+                painter, r.adjusted(1, 1, -1, -1), rounding - 1, swatch, S_button_pressed_specular, S_none);
+            painter->setOpacity(opacity);
+        }
         break;
     }
     case PE_FrameTabWidget: {
@@ -2121,6 +3068,13 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
     }
     case PE_FrameStatusBarItem:
         break;
+    case PE_PanelStatusBar:
+        if (d->hasThemeRule(ThemeParams::StatusBarRule)) {
+            painter->fillRect(option->rect, ThemeParams::statusBarBackground);
+            break;
+        }
+        QCommonStyle::drawPrimitive(elem, option, painter, widget);
+        break;
     case PE_IndicatorTabClose:
     case Phantom_PE_IndicatorTabNew: {
         Swatchy fg = S_windowText;
@@ -2183,6 +3137,8 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         painter->setPen(swatch.color(S_frame_outline));
         QColor background(swatch.color(S_window));
         background.setAlpha(150);
+        if (d->hasThemeRule(ThemeParams::MenuBackgroundRule))
+            background = ThemeParams::menuBackground;
         painter->setBrush(background);
         QRectF frameRect = strokedRect(option->rect, 1);
         painter->drawRoundedRect(frameRect, radius, radius);
@@ -2220,6 +3176,14 @@ void BaseStyle::drawPrimitive(PrimitiveElement elem,
         painter->fillRect(option->rect, swatch.color(S_window_outline));
         break;
     }
+    case PE_Widget: {
+        // Only asked for widgets with Qt::WA_StyledBackground, see polish()
+        if (d->hasThemeRule(ThemeParams::MainMenuBarRule) && Ph::isMainMenuBar(widget))
+            painter->fillRect(option->rect, ThemeParams::gradient(option->rect, ThemeParams::mainMenuBarStops));
+        else
+            QCommonStyle::drawPrimitive(elem, option, painter, widget);
+        break;
+    }
     default:
         QCommonStyle::drawPrimitive(elem, option, painter, widget);
         break;
@@ -2236,10 +3200,11 @@ void BaseStyle::drawControl(ControlElement element,
     const char* elemCString = QMetaEnum::fromType<QStyle::ControlElement>().valueToKey(element);
     EASY_TEXT("Element", elemCString);
 #endif
+    PaintProfiler::Scope profilerScope(PaintProfiler::Control, element);
     using Swatchy = Phantom::Swatchy;
     using namespace Phantom::SwatchColors;
     namespace Ph = Phantom;
-    auto ph_swatchPtr = Ph::getCachedSwatchOfQPalette(&d->swatchCache, &d->headSwatchFastKey, option->palette);
+    auto ph_swatchPtr = d->caches()->swatch(option->palette);
     const Ph::PhSwatch& swatch = *ph_swatchPtr.data();
 
     switch (element) {
@@ -2353,7 +3318,9 @@ void BaseStyle::drawControl(ControlElement element,
         auto toolBar = qstyleoption_cast<const QStyleOptionToolBar*>(option);
         if (!toolBar)
             break;
-        painter->fillRect(option->rect, option->palette.window().color());
+        painter->fillRect(option->rect,
+                          d->hasThemeRule(ThemeParams::ToolBarRule) ? ThemeParams::toolBarBackground
+                                                                    : option->palette.window().color());
         bool isFloating = false;
         if (auto tb = qobject_cast<const QToolBar*>(widget)) {
             isFloating = tb->isFloating();
@@ -2383,7 +3350,7 @@ void BaseStyle::drawControl(ControlElement element,
             painter->translate(-rtrans.left(), -rtrans.top());
         }
         if (!dwOpt->title.isEmpty()) {
-            QString titleText = painter->fontMetrics().elidedText(dwOpt->title, Qt::ElideRight, titleRect.width());
+            QString titleText = d->caches()->elidedText(painter, dwOpt->title, Qt::ElideRight, titleRect.width());
             proxy()->drawItemText(painter,
                                   titleRect,
                                   Qt::AlignLeft | Qt::AlignVCenter | Qt::TextShowMnemonic,
@@ -2600,6 +3567,12 @@ void BaseStyle::drawControl(ControlElement element,
         QRect rect = option->rect;
         Ph::PSave save(painter);
         Ph::paintBorderedRoundRect(painter, rect, rounding, swatch, S_window_outline, S_base);
+        if (d->hasThemeRule(ThemeParams::ProgressBarRule)) {
+            painter->setRenderHint(QPainter::Antialiasing);
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(ThemeParams::progressBarBackground);
+            painter->drawRoundedRect(QRectF(rect).adjusted(1, 1, -1, -1), rounding - 1, rounding - 1);
+        }
         save.restore();
         if (Ph::OverhangShadows && option->state & State_Enabled) {
             // Inner shadow
@@ -2624,9 +3597,17 @@ void BaseStyle::drawControl(ControlElement element,
         Ph::progressBarFillRects(bar, filled, nonFilled, isIndeterminate);
         if (isIndeterminate || bar->progress > bar->minimum) {
             Ph::PSave save(painter);
-            Ph::paintBorderedRoundRect(painter, filled, rounding, swatch, S_progressBar_outline, S_progressBar);
-            Ph::paintBorderedRoundRect(
-                painter, filled.adjusted(1, 1, -1, -1), rounding, swatch, S_progressBar_specular, S_none);
+            if (d->hasThemeRule(ThemeParams::DefaultButtonRule)) {
+                painter->setRenderHint(QPainter::Antialiasing);
+                painter->setPen(Qt::NoPen);
+                painter->setBrush(ThemeParams::gradient(filled, ThemeParams::defaultButtonStops));
+                painter->drawRoundedRect(QRectF(filled), rounding, rounding);
+                Ph::paintBorderedRoundRect(painter, filled, rounding, swatch, S_progressBar_outline, S_none);
+            } else {
+                Ph::paintBorderedRoundRect(painter, filled, rounding, swatch, S_progressBar_outline, S_progressBar);
+                Ph::paintBorderedRoundRect(
+                    painter, filled.adjusted(1, 1, -1, -1), rounding, swatch, S_progressBar_specular, S_none);
+            }
             if (isIndeterminate) {
                 // TODO paint indeterminate indicator
             }
@@ -2639,6 +3620,9 @@ void BaseStyle::drawControl(ControlElement element,
             break;
         if (bar->text.isEmpty())
             break;
+        // The shipped sheet hides the percentage text
+        if (d->hasThemeRule(ThemeParams::ProgressBarRule))
+            break;
         QRect r = bar->rect.adjusted(2, 2, -2, -2);
         if (r.isEmpty() || !r.isValid())
             break;
@@ -2698,11 +3682,21 @@ void BaseStyle::drawControl(ControlElement element,
         if (!isSelected && maybeHasAltKeyNavFocus && widget) {
             isSelected = widget->hasFocus();
         }
-        Swatchy fill = isSelected ? S_highlight : S_window;
-        painter->fillRect(r, swatch.color(fill));
+        if (d->hasThemeRule(ThemeParams::MenuBarTransparentRule)) {
+            // Transparent bar, only the item with an open menu is highlighted
+            isSelected = (itemState & State_Sunken) && d->hasThemeRule(ThemeParams::MenuSelectedRule);
+            if (isSelected)
+                painter->fillRect(r, ThemeParams::gradient(r, ThemeParams::menuSelectedStops));
+        } else {
+            Swatchy fill = isSelected ? S_highlight : S_window;
+            painter->fillRect(r, swatch.color(fill));
+        }
         QPalette::ColorRole textRole = isSelected ? QPalette::HighlightedText : QPalette::Text;
+        QPalette palette = mbi->palette;
+        if (isSelected && d->hasThemeRule(ThemeParams::MenuSelectedRule))
+            palette.setColor(QPalette::HighlightedText, ThemeParams::menuSelectedText);
         proxy()->drawItemText(
-            painter, textRect, alignment, mbi->palette, mbi->state & State_Enabled, mbi->text, textRole);
+            painter, textRect, alignment, palette, mbi->state & State_Enabled, mbi->text, textRole);
         if (Phantom::MenuBarDrawBorder && !isSelected) {
             Ph::fillRectEdges(painter, r, Qt::BottomEdge, 1, swatch.color(S_window_divider));
         }
@@ -2713,7 +3707,7 @@ void BaseStyle::drawControl(ControlElement element,
         auto menuItem = qstyleoption_cast<const QStyleOptionMenuItem*>(option);
         if (!menuItem)
             break;
-        const auto metrics = Ph::MenuItemMetrics::ofFontHeight(option->fontMetrics.height());
+        const auto metrics = d->caches()->metrics(option->fontMetrics.height()).menuItem;
         // Draws one item in a popup menu.
         if (menuItem->menuItemType == QStyleOptionMenuItem::Separator) {
             // Phantom ignores text and icons in menu separators, because
@@ -2741,7 +3735,10 @@ void BaseStyle::drawControl(ControlElement element,
             // rekols: Add rounded rectangle.
             painter->save();
             painter->setPen(Qt::NoPen);
-            painter->setBrush(swatch.color(fillColor));
+            if (d->hasThemeRule(ThemeParams::MenuSelectedRule))
+                painter->setBrush(ThemeParams::gradient(option->rect, ThemeParams::menuSelectedStops));
+            else
+                painter->setBrush(swatch.color(fillColor));
             painter->setRenderHint(QPainter::Antialiasing);
             painter->drawRoundedRect(option->rect, Phantom::DefaultFrame_Radius, Phantom::DefaultFrame_Radius);
             painter->restore();
@@ -2773,7 +3770,7 @@ void BaseStyle::drawControl(ControlElement element,
                 //
                 // if ((isChecked && !isSunken) || (!isChecked && isSunken)) {
                 if (isChecked) {
-                    Ph::drawCheck(painter, d->checkBox_pen_scratch, checkRect, swatch, signColor);
+                    Ph::drawCheck(painter, d->caches()->checkBox_pen_scratch, checkRect, swatch, signColor);
                 }
             }
         }
@@ -2819,7 +3816,10 @@ void BaseStyle::drawControl(ControlElement element,
 #if 0
                 painter->save();
 #endif
-            painter->setPen(swatch.pen(isSelected ? S_highlightedText : S_text));
+            if (isSelected && d->hasThemeRule(ThemeParams::MenuSelectedRule))
+                painter->setPen(ThemeParams::menuSelectedText);
+            else
+                painter->setPen(swatch.pen(isSelected ? S_highlightedText : S_text));
 
             // Comment from original Qt code which did some dance with the font:
             //
@@ -2975,10 +3975,20 @@ void BaseStyle::drawControl(ControlElement element,
             else
                 textRect = textRect.adjusted(indicatorSize, 0, 0, 0);
         }
+        QPalette palette = button->palette;
+        if (d->hasThemeRule(ThemeParams::ButtonRule) && qobject_cast<const QPushButton*>(widget)) {
+            const bool isHover = (button->state & State_Enabled)
+                                 && (button->state & (State_MouseOver | State_Sunken));
+            const bool isDefault = button->features & QStyleOptionButton::DefaultButton;
+            if (isHover && d->hasThemeRule(ThemeParams::HoverButtonRule))
+                palette.setColor(QPalette::ButtonText, ThemeParams::hoverButtonText);
+            else if (isDefault && (button->state & State_Enabled) && d->hasThemeRule(ThemeParams::DefaultButtonRule))
+                palette.setColor(QPalette::ButtonText, ThemeParams::defaultButtonText);
+        }
         proxy()->drawItemText(painter,
                               textRect,
                               tf,
-                              button->palette,
+                              palette,
                               (button->state & State_Enabled),
                               button->text,
                               QPalette::ButtonText);
@@ -2989,7 +3999,8 @@ void BaseStyle::drawControl(ControlElement element,
         if (Phantom::MenuBarDrawBorder) {
             Ph::fillRectEdges(painter, rect, Qt::BottomEdge, 1, swatch.color(S_window_divider));
         }
-        painter->fillRect(rect.adjusted(0, 0, 0, -1), swatch.color(S_window));
+        if (!d->hasThemeRule(ThemeParams::MenuBarTransparentRule))
+            painter->fillRect(rect.adjusted(0, 0, 0, -1), swatch.color(S_window));
         break;
     }
     case CE_TabBarTabShape: {
@@ -3273,7 +4284,13 @@ QPalette BaseStyle::darkModePalette()
 
 QPalette BaseStyle::standardPalette() const
 {
-    return lightModePalette();
+    QPalette palette = m_darkMode ? darkModePalette() : lightModePalette();
+    if (d->hasThemeRule(ThemeParams::SelectionRule)) {
+        palette.setColor(QPalette::All, QPalette::Highlight, ThemeParams::selectionBackground);
+        palette.setColor(QPalette::All, QPalette::HighlightedText, ThemeParams::selectionText);
+        palette.setColor(QPalette::All, QPalette::AlternateBase, ThemeParams::alternateBackground);
+    }
+    return palette;
 
     // QColor backGround(251, 251, 251);
     // QColor light = backGround.lighter(150);
@@ -3329,10 +4346,11 @@ void BaseStyle::drawComplexControl(ComplexControl control,
     const char* controlCString = QMetaEnum::fromType<QStyle::ComplexControl>().valueToKey(control);
     EASY_TEXT("ComplexControl", controlCString);
 #endif
+    PaintProfiler::Scope profilerScope(PaintProfiler::Complex, control);
     using Swatchy = Phantom::Swatchy;
     using namespace Phantom::SwatchColors;
     namespace Ph = Phantom;
-    auto ph_swatchPtr = Ph::getCachedSwatchOfQPalette(&d->swatchCache, &d->headSwatchFastKey, option->palette);
+    auto ph_swatchPtr = d->caches()->swatch(option->palette);
     const Ph::PhSwatch& swatch = *ph_swatchPtr.data();
 
     switch (control) {
@@ -3526,10 +4544,13 @@ void BaseStyle::drawComplexControl(ComplexControl control,
         QRect textRect = proxy()->subControlRect(CC_TitleBar, titleBar, SC_TitleBarLabel, widget);
         painter->setPen(active ? (titleBar->palette.text().color().lighter(120)) : titleBar->palette.text().color());
         // Note workspace also does elliding but it does not use the correct font
-        QString title = painter->fontMetrics().elidedText(titleBar->text, Qt::ElideRight, textRect.width() - 14);
-        painter->drawText(textRect.adjusted(1, 1, 1, 1), title, QTextOption(Qt::AlignHCenter | Qt::AlignVCenter));
+        BaseStylePrivate::Caches* caches = d->caches();
+        QString title = caches->elidedText(painter, titleBar->text, Qt::ElideRight, textRect.width() - 14);
+        const int titleFlags = Qt::AlignHCenter | Qt::AlignVCenter | Qt::TextDontClip;
+        if (!caches->drawStaticText(painter, textRect.adjusted(1, 1, 1, 1), titleFlags, title))
+            painter->drawText(textRect.adjusted(1, 1, 1, 1), title, QTextOption(Qt::AlignHCenter | Qt::AlignVCenter));
         painter->setPen(Qt::white);
-        if (active)
+        if (active && !caches->drawStaticText(painter, textRect, titleFlags, title))
             painter->drawText(textRect, title, QTextOption(Qt::AlignHCenter | Qt::AlignVCenter));
         // min button
         if ((titleBar->subControls & SC_TitleBarMinButton) && (titleBar->titleBarFlags & Qt::WindowMinimizeButtonHint)
@@ -3780,14 +4801,26 @@ void BaseStyle::drawComplexControl(ComplexControl control,
                 (scrollBar->orientation == Qt::Horizontal ? scrollBarSlider.height() : scrollBarSlider.width()) / 2.0;
             bool mouseOver((option->state & State_Active) && option->state & State_MouseOver);
             bool mousePress(option->state & State_Sunken);
+            const QRect thumbRect = scrollBarSlider.adjusted(-1, -1, 1, 1);
+            const qreal hover =
+                m_animationEngine->value(widget, SC_ScrollBarSlider, AnimationEngine::Hover, mouseOver, thumbRect);
+            const qreal press =
+                m_animationEngine->value(widget, SC_ScrollBarSlider, AnimationEngine::Press, mousePress, thumbRect);
+            QColor thumbColor = swatch.color(S_scrollbarSlider);
+            if (hover > 0.0) {
+                const QColor& hoverColor = swatch.color(S_scrollbarSlider_hover);
+                thumbColor = hover < 1.0 ? Phantom::lerpQColor(thumbColor, hoverColor, hover) : hoverColor;
+            }
+            if (press > 0.0) {
+                const QColor& pressColor = swatch.color(S_scrollbarSlider_pressed);
+                thumbColor = press < 1.0 ? Phantom::lerpQColor(thumbColor, pressColor, press) : pressColor;
+            }
             painter->fillRect(scrollBarSlider, swatch.color(S_window));
             // Ph::paintSolidRoundRect(painter, scrollBarSlider, radius, swatch, S_scrollbarSlider);
             painter->save();
             painter->setRenderHint(QPainter::Antialiasing);
             painter->setPen(Qt::NoPen);
-            painter->setBrush(mouseOver ? swatch.brush(S_scrollbarSlider_hover) : swatch.brush(S_scrollbarSlider));
-            if (mousePress)
-                painter->setBrush(swatch.brush(S_scrollbarSlider_pressed));
+            painter->setBrush(thumbColor);
             painter->drawRoundedRect(scrollBarSlider, radius, radius);
             painter->restore();
         }
@@ -3957,17 +4990,28 @@ void BaseStyle::drawComplexControl(ComplexControl control,
             } else {
                 handleOutline = S_window_outline;
             }
-            if (isPressed) {
-                handleFill = S_sliderHandle_pressed;
-                handleSpecular = S_sliderHandle_pressed_specular;
-            } else {
-                handleFill = S_sliderHandle;
-                handleSpecular = S_sliderHandle_specular;
-            }
+            handleFill = S_sliderHandle;
+            handleSpecular = S_sliderHandle_specular;
+            const qreal press = m_animationEngine->value(widget, SC_SliderHandle, AnimationEngine::Press, isPressed, r);
             Ph::PSave save(painter);
-            Ph::paintBorderedRoundRect(painter, r, Ph::SliderHandle_Rounding, swatch, handleOutline, handleFill);
-            r.adjust(1, 1, -1, -1);
-            Ph::paintBorderedRoundRect(painter, r, Ph::SliderHandle_Rounding, swatch, handleSpecular, S_none);
+            if (press < 1.0) {
+                Ph::paintBorderedRoundRect(painter, r, Ph::SliderHandle_Rounding, swatch, handleOutline, handleFill);
+                Ph::paintBorderedRoundRect(
+                    painter, r.adjusted(1, 1, -1, -1), Ph::SliderHandle_Rounding, swatch, handleSpecular, S_none);
+            }
+            if (press > 0.0) {
+                const qreal opacity = painter->opacity();
+                painter->setOpacity(opacity * press);
+                Ph::paintBorderedRoundRect(
+                    painter, r, Ph::SliderHandle_Rounding, swatch, handleOutline, S_sliderHandle_pressed);
+                Ph::paintBorderedRoundRect(painter,
+                                           r.adjusted(1, 1, -1, -1),
+                                           Ph::SliderHandle_Rounding,
+                                           swatch,
+                                           S_sliderHandle_pressed_specular,
+                                           S_none);
+                painter->setOpacity(opacity);
+            }
         }
         break;
     }
@@ -4065,13 +5109,15 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
     case PM_MenuBarItemSpacing:
         val = Phantom::MenuBar_ItemSpacing;
         break;
-    case PM_MenuBarHMargin:
+    case PM_MenuBarHMargin: {
         // option is usually nullptr, use widget instead to get font metrics
         if (!Phantom::MenuBarLeftMargin || !widget) {
             val = 0;
             break;
         }
-        return widget->fontMetrics().height() * Phantom::MenuBar_HorizontalPaddingFontRatio;
+        BaseStylePrivate::Caches* caches = d->caches();
+        return caches->metrics(caches->fontHeight(widget)).menuBarHMargin;
+    }
     case PM_MenuBarVMargin:
     case PM_MenuBarPanelWidth:
         val = 0;
@@ -4103,7 +5149,7 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
             // styleoption when querying for PM_SmallIconSize. The best we can do is
             // use the font set on the widget itself, which is obviously going to be
             // wrong if the row has a custom font set on it. Hmm.
-            return widget->fontMetrics().height();
+            return d->caches()->fontHeight(widget);
         }
         val = 16;
         break;
@@ -4111,7 +5157,7 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
         if (option)
             return option->fontMetrics.height();
         if (widget)
-            return widget->fontMetrics().height();
+            return d->caches()->fontHeight(widget);
         val = 16;
         break;
     }
@@ -4134,13 +5180,11 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
         // in sizeFromContents for CT_TabBarTab.
         if (!option)
             break;
-        return static_cast<int>(option->fontMetrics.height() * Phantom::TabBar_HPaddingFontRatio)
-               + static_cast<int>(Phantom::dpiScaled(4));
+        return d->caches()->metrics(option->fontMetrics.height()).tabBarTabHSpace;
     case PM_TabBarTabVSpace:
         if (!option)
             break;
-        return static_cast<int>(option->fontMetrics.height() * Phantom::TabBar_VPaddingFontRatio)
-               + static_cast<int>(Phantom::dpiScaled(2));
+        return d->caches()->metrics(option->fontMetrics.height()).tabBarTabVSpace;
     case PM_TabBarTabOverlap:
         val = 1;
         break;
@@ -4150,7 +5194,7 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
     case PM_TabBarIconSize: {
         if (!widget)
             break;
-        return widget->fontMetrics().height();
+        return d->caches()->fontHeight(widget);
     }
     case PM_TabBarTabShiftVertical: {
         val = Phantom::TabBar_InctiveVShift;
@@ -4170,7 +5214,7 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
         if (option)
             return option->fontMetrics.height();
         if (widget)
-            return widget->fontMetrics().height();
+            return d->caches()->fontHeight(widget);
         val = 14;
         break;
     case PM_ScrollView_ScrollBarOverlap:
@@ -4179,7 +5223,7 @@ int BaseStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const
         break;
     case PM_TreeViewIndentation: {
         if (widget)
-            return widget->fontMetrics().height();
+            return d->caches()->fontHeight(widget);
         val = 12;
         break;
     }
@@ -4232,13 +5276,18 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
         int fontMetricsHeight = -1;
         // See notes at CE_MenuItem and SH_ComboBox_Popup for more information
         if (Ph::UseQMenuForComboBoxPopup && qobject_cast<const QComboBox*>(widget)) {
-            if (!widget->testAttribute(Qt::WA_SetFont))
-                fontMetricsHeight = QFontMetrics(qApp->font("QMenu")).height();
+            if (!widget->testAttribute(Qt::WA_SetFont)) {
+                // Asked for every row of the popup, so only measure the font once
+                BaseStylePrivate::Caches* caches = d->caches();
+                if (caches->menuFontHeight < 0)
+                    caches->menuFontHeight = QFontMetrics(qApp->font("QMenu")).height();
+                fontMetricsHeight = caches->menuFontHeight;
+            }
         }
         if (fontMetricsHeight == -1) {
             fontMetricsHeight = option->fontMetrics.height();
         }
-        auto metrics = Ph::MenuItemMetrics::ofFontHeight(fontMetricsHeight);
+        auto metrics = d->caches()->metrics(fontMetricsHeight).menuItem;
         // Incoming width is the sum of the visual widths of the main item text and
         // the mnemonic text (if any). To this width we will add the widths of the
         // other features for this menu item -- the icon/checkbox, spacing between
@@ -4324,7 +5373,7 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
         int yadd = 0;
         if (opt->subControls & (SC_GroupBoxCheckBox | SC_GroupBoxLabel)) {
             int fontHeight = option->fontMetrics.height();
-            yadd += static_cast<int>(fontHeight * Phantom::GroupBox_LabelBottomMarginFontRatio);
+            yadd += d->caches()->metrics(fontHeight).groupBoxLabelBottomMargin;
         }
         // We can test for the frame in general, but unfortunately testing to see
         // if it's the 1-line "flat" style or 4-line box/rect "anything else" style
@@ -4339,30 +5388,43 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
         auto vopt = qstyleoption_cast<const QStyleOptionViewItem*>(option);
         if (!vopt)
             break;
-        QSize sz = QCommonStyle::sizeFromContents(type, option, size, widget);
-        sz += QSize(0, Phantom::DefaultFrameWidth);
-        // QCommonStyle has a bunch of complicated logic for laying out/calculating
-        // rects of view items, which is locked behind a private data guy. In
-        // sizeFromContents for CT_ItemViewItem, it unions all of the item row's
-        // rects together and then, if the decoration height is exactly the same as
-        // the row height, it adds 2 pixels (not dpi scaled) to the height. The
-        // comment says it's to prevent "icons from overlapping" but I have no idea
-        // how that's supposed to help. And we don't necessarily want those extra 2
-        // pixels. Anyway, I don't want to copy and paste all of that code into
-        // Phantom and then maintain it. So when Phantom is in the mode where we're
-        // basing the item view decoration sizes off of the font size, we'll just
-        // take a guess when QCommonStyle has added 2 to the height (because the
-        // row height and decoration height are both the font height), and
-        // re-remove those two pixels.
+        Ph::SizeCacheKey key;
+        key.type = type;
+        key.fontHeight = vopt->fontMetrics.height();
+        key.textHash = qHash(vopt->text);
+        key.width = size.width();
+        key.height = size.height();
+        key.iconWidth = vopt->decorationSize.width();
+        key.iconHeight = vopt->decorationSize.height();
+        key.flags = int(vopt->features) | vopt->decorationPosition << 8 | int(vopt->displayAlignment) << 12;
+        // Wrapped text is laid out against the item width
+        key.extra = vopt->features & QStyleOptionViewItem::WrapText ? vopt->rect.width() : -1;
+        return Ph::cachedSize(&d->caches()->sizeCache, key, vopt->fontMetrics, vopt->text, [&] {
+            QSize sz = QCommonStyle::sizeFromContents(type, option, size, widget);
+            sz += QSize(0, Phantom::DefaultFrameWidth);
+            // QCommonStyle has a bunch of complicated logic for laying out/calculating
+            // rects of view items, which is locked behind a private data guy. In
+            // sizeFromContents for CT_ItemViewItem, it unions all of the item row's
+            // rects together and then, if the decoration height is exactly the same as
+            // the row height, it adds 2 pixels (not dpi scaled) to the height. The
+            // comment says it's to prevent "icons from overlapping" but I have no idea
+            // how that's supposed to help. And we don't necessarily want those extra 2
+            // pixels. Anyway, I don't want to copy and paste all of that code into
+            // Phantom and then maintain it. So when Phantom is in the mode where we're
+            // basing the item view decoration sizes off of the font size, we'll just
+            // take a guess when QCommonStyle has added 2 to the height (because the
+            // row height and decoration height are both the font height), and
+            // re-remove those two pixels.
 #if 1
-        if (Phantom::ItemView_UseFontHeightForDecorationSize) {
-            int fh = vopt->fontMetrics.height();
-            if (sz.height() == fh + 2 && vopt->decorationSize.height() == fh) {
-                sz.setHeight(fh);
+            if (Phantom::ItemView_UseFontHeightForDecorationSize) {
+                int fh = vopt->fontMetrics.height();
+                if (sz.height() == fh + 2 && vopt->decorationSize.height() == fh) {
+                    sz.setHeight(fh);
+                }
             }
-        }
 #endif
-        return sz;
+            return sz;
+        });
     }
     case CT_HeaderSection: {
         auto hdr = qstyleoption_cast<const QStyleOptionHeader*>(option);
@@ -4371,19 +5433,27 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
         // This is pretty crummy. Should also check if we need multi-line support
         // or not.
         bool nullIcon = hdr->icon.isNull();
-        int margin = proxy()->pixelMetric(QStyle::PM_HeaderMargin, hdr, widget);
-        int iconSize = nullIcon ? 0 : option->fontMetrics.height();
-        QSize txt = hdr->fontMetrics.size(Qt::TextSingleLine | Qt::TextBypassShaping, hdr->text);
-        QSize sz;
-        sz.setHeight(margin + qMax(iconSize, txt.height()) + margin);
-        sz.setWidth((nullIcon ? 0 : margin) + iconSize + (hdr->text.isNull() ? 0 : margin) + txt.width() + margin);
-        if (hdr->sortIndicator != QStyleOptionHeader::None) {
-            if (hdr->orientation == Qt::Horizontal)
-                sz.rwidth() += sz.height() + margin;
-            else
-                sz.rheight() += sz.width() + margin;
-        }
-        return sz;
+        Ph::SizeCacheKey key;
+        key.type = type;
+        key.fontHeight = hdr->fontMetrics.height();
+        key.textHash = qHash(hdr->text);
+        key.iconWidth = nullIcon ? 0 : 1;
+        key.flags = hdr->sortIndicator | hdr->orientation << 4 | int(hdr->text.isNull()) << 8;
+        return Ph::cachedSize(&d->caches()->sizeCache, key, hdr->fontMetrics, hdr->text, [&] {
+            int margin = proxy()->pixelMetric(QStyle::PM_HeaderMargin, hdr, widget);
+            int iconSize = nullIcon ? 0 : option->fontMetrics.height();
+            QSize txt = hdr->fontMetrics.size(Qt::TextSingleLine | Qt::TextBypassShaping, hdr->text);
+            QSize sz;
+            sz.setHeight(margin + qMax(iconSize, txt.height()) + margin);
+            sz.setWidth((nullIcon ? 0 : margin) + iconSize + (hdr->text.isNull() ? 0 : margin) + txt.width() + margin);
+            if (hdr->sortIndicator != QStyleOptionHeader::None) {
+                if (hdr->orientation == Qt::Horizontal)
+                    sz.rwidth() += sz.height() + margin;
+                else
+                    sz.rheight() += sz.width() + margin;
+            }
+            return sz;
+        });
     }
     default:
         break;
@@ -4396,7 +5466,9 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
         auto pbopt = qstyleoption_cast<const QStyleOptionButton*>(option);
         if (!pbopt || pbopt->text.isEmpty())
             break;
-        int hpad = static_cast<int>(pbopt->fontMetrics.height() * Phantom::PushButton_HorizontalPaddingFontHeightRatio);
+        int hpad = d->caches()->metrics(pbopt->fontMetrics.height()).pushButtonHPad;
+        if (d->hasThemeRule(ThemeParams::ButtonRule) && qobject_cast<const QPushButton*>(widget))
+            hpad = ThemeParams::buttonHorizontalPadding;
         newSize.rwidth() += hpad * 2;
         if (widget && qobject_cast<const QDialogButtonBox*>(widget->parent())) {
             int dialogButtonMinWidth = Phantom::dpiScaled(80);
@@ -4440,6 +5512,10 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
     case CT_SpinBox:
         // No changes needed
         break;
+    case CT_ProgressBar:
+        if (d->hasThemeRule(ThemeParams::ProgressBarRule) && option->state & State_Horizontal)
+            newSize.setHeight(ThemeParams::progressBarHeight);
+        break;
     case CT_SizeGrip:
         newSize += QSize(4, 4);
         break;
@@ -4454,9 +5530,9 @@ QSize BaseStyle::sizeFromContents(ContentsType type,
 
 void BaseStyle::polish(QApplication* app)
 {
+    StartupTrace::Scope trace("BaseStyle::polish(QApplication)");
     QCommonStyle::polish(app);
 
-    app->setPalette(standardPalette());
 /*
     // probono: For unkown reasons, 'filer-qt --desktop' crashes
     // when we apply a stylesheet.
@@ -4467,26 +5543,16 @@ void BaseStyle::polish(QApplication* app)
     }
 */
 
-    // probono: Use ~/.config/stylesheet.qss or /etc/xdg/tylesheet.qss if exists
-    QString qsspath;
-    qsspath = QStandardPaths::locate(QStandardPaths::ConfigLocation, QStringLiteral("stylesheet.qss"), QStandardPaths::LocateFile);
-    if(qsspath.isEmpty() == false) {
-        // QMessageBox *msgBox = new QMessageBox(QMessageBox::NoIcon, "Title", qsspath);
-        // msgBox->exec();
-        QFile File(qsspath);
-        File.open(QFile::ReadOnly);
-        QString StyleSheet = QLatin1String(File.readAll());
-
-        // probono: No matter what the stylesheet may say, we want to set the font size
-        if (app->applicationFilePath().endsWith("Menu")) {
-            qDebug() << "probono: Hardcoding font size for menu to 15px";
-            app->setStyleSheet(StyleSheet + "QWidget { font-size: 15px; }");
-            // app->setStyleSheet("QWidget { font-size: 15px; }");
-        } else {
-            app->setStyleSheet(StyleSheet + "QMenu { font-size: 15px; }" + "QMenuBar { font-size: 15px; }");
-        }
+    applyStyleSheet(app);
 
-    }
+    app->setPalette(standardPalette());
+
+    // Lets the platform theme reach us for dark mode switches even when an
+    // application style sheet wraps us in a proxy style
+    app->setProperty("_panda_style_object", QVariant::fromValue<QObject*>(this));
+
+    // After the first window is on screen, so it doesn't hold it up
+    schedulePrewarm();
 
     // app->setStyleSheet("QWidget { background-color: yellow; } QPushButton { background-color: blue; }"); // probono
     // if (QObject *obj = hintsSettings()) {
@@ -4495,27 +5561,206 @@ void BaseStyle::polish(QApplication* app)
     // }
 }
 
+void BaseStyle::schedulePrewarm()
+{
+    // Only the device pixel ratios of the screens there are
+    const QVector<qreal> ratios = ShadowHelper::screenDevicePixelRatios();
+
+    // Paints a control into a scratch image, for the caches it fills on the way
+    auto paintControl = [ratios](auto draw) {
+        return [ratios, draw] {
+            for (qreal dpr : ratios) {
+                QImage scratch(QSize(200, 32) * dpr, QImage::Format_ARGB32_Premultiplied);
+                scratch.setDevicePixelRatio(dpr);
+                scratch.fill(Qt::transparent);
+                QPainter painter(&scratch);
+                draw(&painter, QApplication::palette());
+            }
+        };
+    };
+
+    // In the order the first interactions usually need them
+    const QVector<PrewarmScheduler::Task> tasks = {
+        [this] { d->caches()->swatch(QApplication::palette()); },
+        paintControl([this](QPainter *painter, const QPalette &palette) {
+            QStyleOptionButton option;
+            option.palette = palette;
+            option.rect = QRect(0, 0, 96, 24);
+            for (State state : {State_Enabled | State_Raised | State_MouseOver,
+                                State_Enabled | State_Sunken}) {
+                option.state = state;
+                drawPrimitive(PE_PanelButtonCommand, &option, painter);
+            }
+        }),
+        [this, ratios] {
+            for (qreal dpr : ratios) {
+                m_shadowHelper->shadowTiles(ShadowHelper::ShadowMedium, Phantom::DefaultFrame_Radius, dpr);
+                m_shadowHelper->shadowTiles(ShadowHelper::ShadowSmall, Phantom::DefaultFrame_Radius, dpr);
+            }
+        },
+        paintControl([this](QPainter *painter, const QPalette &palette) {
+            QStyleOptionMenuItem option;
+            option.palette = palette;
+            option.rect = QRect(0, 0, 200, 24);
+            option.state = State_Enabled | State_Selected;
+            option.menuItemType = QStyleOptionMenuItem::SubMenu;
+            option.text = QStringLiteral(" ");
+            drawControl(CE_MenuItem, &option, painter);
+        }),
+        paintControl([this](QPainter *painter, const QPalette &palette) {
+            QStyleOptionSlider option;
+            option.palette = palette;
+            option.orientation = Qt::Vertical;
+            option.state = State_Enabled | State_MouseOver;
+            option.subControls = SC_All;
+            option.rect = QRect(0, 0, pixelMetric(PM_ScrollBarExtent, &option), 32);
+            option.maximum = 100;
+            option.pageStep = 10;
+            drawComplexControl(CC_ScrollBar, &option, painter);
+        }),
+        paintControl([this](QPainter *painter, const QPalette &palette) {
+            QStyleOptionComboBox option;
+            option.palette = palette;
+            option.rect = QRect(0, 0, 120, 24);
+            option.state = State_Enabled;
+            option.subControls = SC_All;
+            drawComplexControl(CC_ComboBox, &option, painter);
+        }),
+        [this, ratios] {
+            for (qreal dpr : ratios)
+                prewarmIndicators(dpr);
+        },
+    };
+    m_prewarmScheduler->schedule(tasks);
+}
+
+void BaseStyle::prewarmIndicators(qreal dpr)
+{
+    // Render the check box and radio button states of the application palette
+    // into the indicator atlas, so the first checkable view doesn't have to.
+    QImage scratch(QSize(Phantom::IndicatorAtlas_MaxExtent, Phantom::IndicatorAtlas_MaxExtent) * dpr,
+                   QImage::Format_ARGB32_Premultiplied);
+    scratch.setDevicePixelRatio(dpr);
+    QPainter painter(&scratch);
+
+    const State checkStates[] = {State_Off, State_On, State_NoChange};
+    QStyleOptionButton option;
+    for (bool enabled : {true, false}) {
+        option.palette = QApplication::palette();
+        option.palette.setCurrentColorGroup(enabled ? QPalette::Active : QPalette::Disabled);
+        for (State checkState : checkStates) {
+            option.state = checkState | (enabled ? State_Enabled : State_None);
+            option.rect = QRect(0, 0, pixelMetric(PM_IndicatorWidth, &option), pixelMetric(PM_IndicatorHeight, &option));
+            drawPrimitive(PE_IndicatorCheckBox, &option, &painter);
+            if (checkState == State_NoChange)
+                continue;
+            option.rect = QRect(0, 0,
+                                pixelMetric(PM_ExclusiveIndicatorWidth, &option),
+                                pixelMetric(PM_ExclusiveIndicatorHeight, &option));
+            drawPrimitive(PE_IndicatorRadioButton, &option, &painter);
+        }
+    }
+}
+
+void BaseStyle::applyStyleSheet(QApplication *app)
+{
+    StartupTrace::Scope trace("BaseStyle::applyStyleSheet");
+
+    // The rules we know from the shipped stylesheet are painted natively, only
+    // what goes beyond them needs Qt's style sheet machinery
+    const StyleSheetLoader::Result styleSheet = m_styleSheetLoader->load();
+    d->themeRules = styleSheet.themeRules;
+    d->invalidateMetricCaches();
+
+    // Without a style sheet file only the built-in look is left; a style sheet
+    // the application set itself stays
+    if (styleSheet.path.isEmpty()) {
+        if (!d->appliedStyleSheet.isEmpty() && app->styleSheet() == d->appliedStyleSheet)
+            app->setStyleSheet(QString());
+        d->appliedStyleSheet.clear();
+        d->styleSheetFonts = false;
+        return;
+    }
+
+    d->styleSheetFonts = true;
+    applyFonts(app);
+
+    // Setting a style sheet re-polishes every widget even if it did not change.
+    // A style sheet the application set itself is only replaced by a non-empty one.
+    const QString current = app->styleSheet();
+    if (current != styleSheet.styleSheet
+        && (!styleSheet.styleSheet.isEmpty() || current == d->appliedStyleSheet)) {
+        app->setStyleSheet(styleSheet.styleSheet);
+        d->appliedStyleSheet = styleSheet.styleSheet;
+    }
+}
+
+void BaseStyle::applyFonts(QApplication *app)
+{
+    // probono: No matter what the stylesheet may say, we want to set the font size
+    QFont menuFont = app->font();
+    menuFont.setPixelSize(ThemeParams::menuFontPixelSize);
+    if (app->applicationFilePath().endsWith("Menu")) {
+        // Setting a different application font emits fontChanged() again
+        if (app->font() != menuFont) {
+            qDebug() << "probono: Hardcoding font size for menu to 15px";
+            app->setFont(menuFont);
+        }
+    } else {
+        app->setFont(menuFont, "QMenu");
+        app->setFont(menuFont, "QMenuBar");
+        if (d->themeRules.testFlag(ThemeParams::ButtonRule)) {
+            QFont buttonFont = app->font();
+            buttonFont.setPointSizeF(ThemeParams::buttonFontPointSize);
+            app->setFont(buttonFont, "QPushButton");
+        }
+    }
+}
+
 void BaseStyle::unpolish(QApplication* app)
 {
     QCommonStyle::unpolish(app);
 
+    d->invalidateMetricCaches();
+
+    if (qvariant_cast<QObject*>(app->property("_panda_style_object")) == this)
+        app->setProperty("_panda_style_object", QVariant());
+
     // if (QObject *obj = hintsSettings()) {
     //     disconnect(obj, SIGNAL(systemFontChanged(QString)), this, SLOT(updateAppFont()));
     //     disconnect(obj, SIGNAL(systemFontPointSizeChanged(qreal)), this, SLOT(updateAppFont()));
     // }
 }
 
-void BaseStyle::polish(QWidget *widget)
+void BaseStyle::setDarkMode(bool darkMode)
 {
-    QCommonStyle::polish(widget);
+    if (m_darkMode == darkMode)
+        return;
 
-    // probono: Hardcode QPushButton height to 22 pixels
-    if (qobject_cast<QPushButton*>(widget))
-    {
-        widget->setFixedHeight(22);
-        // int radius = widget->height() / 2;
-        // button->setStyleSheet(QString("border-radius: %1px;").arg(radius)); // This crashes. Why?
+    m_darkMode = darkMode;
+    d->lightTheme = !darkMode;
+    const QPalette palette = standardPalette();
+
+    // Derive the swatches of every color group up front, so the first repaint
+    // after the switch does not stall on them widget by widget.
+    for (QPalette::ColorGroup group : {QPalette::Active, QPalette::Inactive, QPalette::Disabled}) {
+        QPalette groupPalette(palette);
+        groupPalette.setCurrentColorGroup(group);
+        d->caches()->swatch(groupPalette);
+    }
+
+    // Every widget only schedules an update() for the palette change, which
+    // the backing store coalesces into one repaint per window. The pixmap
+    // caches of the new palette are filled once that repaint is done.
+    if (qApp && qvariant_cast<QObject*>(qApp->property("_panda_style_object")) == this) {
+        qApp->setPalette(palette);
+        schedulePrewarm();
     }
+}
+
+void BaseStyle::polish(QWidget *widget)
+{
+    QCommonStyle::polish(widget);
 
     if (false
             || qobject_cast<QAbstractButton*>(widget)
@@ -4532,6 +5777,48 @@ void BaseStyle::polish(QWidget *widget)
         widget->setAttribute(Qt::WA_OpaquePaintEvent, false);
     }
 
+    // Translucency has to be decided before the native window is created,
+    // so it cannot wait for the deferred polish
+    if (qobject_cast<QMenu *>(widget)) {
+        widget->setAttribute(Qt::WA_TranslucentBackground, false); // probono: was: true
+    }
+
+    if (widget->inherits("QTipLabel") || widget->inherits("QComboBoxPrivateContainer")) {
+        widget->setAttribute(Qt::WA_TranslucentBackground, false); // probono: was: true
+    }
+
+    // Picks the popup kind before it opens, see Phantom::watchComboBoxModel()
+    if (auto combo = qobject_cast<QComboBox *>(widget)) {
+        Phantom::watchComboBoxModel(combo);
+        widget->installEventFilter(this);
+    }
+
+    // Named widgets of the panda applications, see ThemeParams
+    if (Phantom::isSearchField(widget)) {
+        // The focused text color has to go through the palette, see eventFilter()
+        widget->installEventFilter(this);
+    } else if (Phantom::isMainMenuBar(widget)) {
+        widget->setAttribute(Qt::WA_StyledBackground);
+    }
+
+    // Only queue widgets that have deferred work to do; windows are the shadow candidates
+    if (m_polishHelper && (widget->isWindow() || qobject_cast<QPushButton*>(widget))) {
+        m_polishHelper->registerWidget(widget);
+    } else {
+        polishDeferred(widget);
+    }
+}
+
+void BaseStyle::polishDeferred(QWidget *widget)
+{
+    // probono: Hardcode QPushButton height to 22 pixels
+    if (qobject_cast<QPushButton*>(widget))
+    {
+        widget->setFixedHeight(22);
+        // int radius = widget->height() / 2;
+        // button->setStyleSheet(QString("border-radius: %1px;").arg(radius)); // This crashes. Why?
+    }
+
     // probono: Alert sounds
     if (qobject_cast<QMessageBox *>(widget)) {
         QMessageBox::Icon icon = qobject_cast<QMessageBox *>(widget)->icon();
@@ -4547,14 +5834,6 @@ void BaseStyle::polish(QWidget *widget)
             sound::playSound("ping.wav");
     }
 
-    if (qobject_cast<QMenu *>(widget)) {
-        widget->setAttribute(Qt::WA_TranslucentBackground, false); // probono: was: true
-    }
-
-    if (widget->inherits("QTipLabel") || widget->inherits("QComboBoxPrivateContainer")) {
-        widget->setAttribute(Qt::WA_TranslucentBackground, false); // probono: was: true
-    }
-
     m_shadowHelper->registerWidget(widget);
 }
 
@@ -4583,13 +5862,75 @@ void BaseStyle::unpolish(QWidget *widget)
         widget->setAttribute(Qt::WA_TranslucentBackground, false);
     }
 
+    if (Phantom::isSearchField(widget) || qobject_cast<QComboBox *>(widget))
+        widget->removeEventFilter(this);
+    if (auto combo = qobject_cast<QComboBox *>(widget))
+        Phantom::unwatchComboBoxModel(combo);
+    const QVariant savedPalette = widget->property("_panda_saved_palette");
+    if (savedPalette.isValid()) {
+        widget->setProperty("_panda_saved_palette", QVariant());
+        widget->setPalette(qvariant_cast<QPalette>(savedPalette));
+    }
+
+    if (m_polishHelper)
+        m_polishHelper->unregisterWidget(widget);
     m_shadowHelper->unregisterWidget(widget);
+    m_animationEngine->unregisterWidget(widget);
+}
+
+bool BaseStyle::eventFilter(QObject *watched, QEvent *event)
+{
+    // Catches a model set since polish(); the presses that open a combo box
+    // popup reach the filter first
+    if (event->type() == QEvent::Show || event->type() == QEvent::MouseButtonPress
+        || event->type() == QEvent::KeyPress) {
+        if (auto combo = qobject_cast<QComboBox *>(watched))
+            Phantom::watchComboBoxModel(combo);
+    }
+
+    // QLineEdit sets its pen from the palette after PE_PanelLineEdit, so the
+    // white text of the focused search field has to be put into its palette.
+    // The palette it had before goes back on focus out, so neither a palette
+    // the application set nor later palette changes get lost.
+    if (event->type() == QEvent::FocusIn || event->type() == QEvent::FocusOut) {
+        auto lineEdit = qobject_cast<QLineEdit *>(watched);
+        if (lineEdit && Phantom::isSearchField(lineEdit)) {
+            const QVariant saved = lineEdit->property("_panda_saved_palette");
+            if (saved.isValid()) {
+                lineEdit->setProperty("_panda_saved_palette", QVariant());
+                lineEdit->setPalette(qvariant_cast<QPalette>(saved));
+            }
+            if (event->type() == QEvent::FocusIn && d->hasThemeRule(ThemeParams::SearchFieldFocusRule)) {
+                QPalette palette = lineEdit->palette();
+                lineEdit->setProperty("_panda_saved_palette", QVariant::fromValue(palette));
+                palette.setColor(QPalette::Text, ThemeParams::searchFieldFocusText);
+                lineEdit->setPalette(palette);
+            }
+        }
+    }
+    return QCommonStyle::eventFilter(watched, event);
 }
 
 QRect BaseStyle::subControlRect(ComplexControl control,
                                 const QStyleOptionComplex* option,
                                 SubControl subControl,
                                 const QWidget* widget) const
+{
+    Phantom::GeometryCacheKey key;
+    if (!Phantom::geometryCacheKey(control, option, subControl, widget, &key))
+        return computeSubControlRect(control, option, subControl, widget);
+    Phantom::GeometryCache& cache = d->caches()->geometryCache;
+    if (const QRect* rect = cache.find(key))
+        return *rect;
+    const QRect rect = computeSubControlRect(control, option, subControl, widget);
+    cache.insert(key, rect);
+    return rect;
+}
+
+QRect BaseStyle::computeSubControlRect(ComplexControl control,
+                                       const QStyleOptionComplex* option,
+                                       SubControl subControl,
+                                       const QWidget* widget) const
 {
     namespace Ph = Phantom;
     QRect rect = QCommonStyle::subControlRect(control, option, subControl, widget);
@@ -4698,7 +6039,7 @@ QRect BaseStyle::subControlRect(ComplexControl control,
             if (groupBox->subControls & (SC_GroupBoxLabel | SC_GroupBoxCheckBox)) {
                 int fontHeight = option->fontMetrics.height();
                 int topMargin = qMax(pixelMetric(PM_ExclusiveIndicatorHeight), fontHeight);
-                topMargin += static_cast<int>(fontHeight * Ph::GroupBox_LabelBottomMarginFontRatio);
+                topMargin += d->caches()->metrics(fontHeight).groupBoxLabelBottomMargin;
                 r.setTop(r.top() + topMargin);
             }
             if (subControl == SC_GroupBoxContents && groupBox->subControls & SC_GroupBoxFrame) {
@@ -4922,23 +6263,45 @@ QStyle::SubControl BaseStyle::hitTestComplexControl(ComplexControl cc,
 
 QPixmap BaseStyle::generatedIconPixmap(QIcon::Mode iconMode, const QPixmap& pixmap, const QStyleOption* opt) const
 {
-    // Default icon highlight is way too subtle
-    if (iconMode == QIcon::Selected) {
-        QImage img = pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
-        QPainter painter(&img);
-
-        painter.setCompositionMode(QPainter::CompositionMode_SourceAtop);
+    if (pixmap.isNull() || (iconMode != QIcon::Selected && iconMode != QIcon::Disabled))
+        return pixmap;
 
-        QColor color =
-            Phantom::DeriveColors::adjustLightness(opt->palette.color(QPalette::Normal, QPalette::Highlight), .25);
+    const QPalette& palette = opt ? opt->palette : QApplication::palette();
+    QColor color;
+    if (iconMode == QIcon::Selected) {
+        // Default icon highlight is way too subtle
+        color = Phantom::DeriveColors::adjustLightness(palette.color(QPalette::Normal, QPalette::Highlight), .25);
         color.setAlphaF(0.25);
-        painter.fillRect(0, 0, img.width(), img.height(), color);
+    } else {
+        color = palette.color(QPalette::Disabled, QPalette::Window);
+    }
 
-        painter.end();
+    // The cache holds pixmaps, which belong to the GUI thread
+    const bool useCache = d->isGuiThread();
+    Phantom::IconCacheKey key;
+    key.pixmapKey = pixmap.cacheKey();
+    key.color = color.rgba();
+    key.mode = iconMode;
+    if (useCache) {
+        if (const QPixmap* cached = d->iconCache.object(key)) {
+            PaintProfiler::count(PaintProfiler::IconCacheHit);
+            return *cached;
+        }
+        PaintProfiler::count(PaintProfiler::IconCacheMiss);
+    }
 
-        return QPixmap::fromImage(img);
+    QImage img;
+    if (iconMode == QIcon::Selected) {
+        img = pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        Phantom::tintPremultiplied(&img, color.rgba());
+    } else {
+        img = pixmap.toImage().convertToFormat(QImage::Format_ARGB32);
+        Phantom::disableARGB32(&img, color);
     }
-    return QCommonStyle::generatedIconPixmap(iconMode, pixmap, opt);
+    const QPixmap result = QPixmap::fromImage(img);
+    if (useCache)
+        d->iconCache.insert(key, new QPixmap(result), qMax(1, img.bytesPerLine() * img.height() / 1024));
+    return result;
 }
 
 int BaseStyle::styleHint(StyleHint hint,
@@ -5025,7 +6388,12 @@ int BaseStyle::styleHint(StyleHint hint,
     case SH_ScrollView_FrameOnlyAroundContents:
         return 0;
     case SH_ComboBox_Popup: {
-        return Phantom::UseQMenuForComboBoxPopup;
+        if (!Phantom::UseQMenuForComboBoxPopup)
+            return 0;
+        // Long combo boxes drop down a list, see Phantom::updateComboBoxPopup()
+        if (widget && widget->property("_panda_list_popup").toBool())
+            return 0;
+        return 1;
         // Fusion did this, but we don't because of font bugs (especially in high
         // DPI) with the QMenu that the combo box will create instead of a dropdown
         // view. See notes in CE_MenuItem for more details.
@@ -5038,7 +6406,7 @@ int BaseStyle::styleHint(StyleHint hint,
         namespace Ph = Phantom;
         if (!option)
             return 0;
-        auto ph_swatchPtr = Ph::getCachedSwatchOfQPalette(&d->swatchCache, &d->headSwatchFastKey, option->palette);
+        auto ph_swatchPtr = d->caches()->swatch(option->palette);
         const Ph::PhSwatch& swatch = *ph_swatchPtr.data();
         // Qt code in table views for drawing grid lines is broken. See case for
         // CE_ItemViewItem painting for more information.
@@ -5128,6 +6496,8 @@ QRect BaseStyle::subElementRect(SubElement sr, const QStyleOption* opt, const QW
     }
     case SE_LineEditContents: {
         QRect r = QCommonStyle::subElementRect(sr, opt, w);
+        if (d->hasThemeRule(ThemeParams::SearchFieldRule) && Phantom::isSearchField(w))
+            return r.adjusted(ThemeParams::searchFieldHorizontalPadding, 0, -ThemeParams::searchFieldHorizontalPadding, 0);
         int pad = Phantom::dpiScaled(Phantom::LineEdit_ContentsHPad);
         return r.adjusted(pad, 0, -pad, 0);
     }
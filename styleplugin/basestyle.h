@@ -27,6 +27,22 @@
 
 class BaseStylePrivate;
 class ShadowHelper;
+class PolishHelper;
+class StyleSheetLoader;
+class AnimationEngine;
+class PrewarmScheduler;
+
+/**
+ * Threading: the style is used from the GUI thread. With PANDA_STYLE_THREADSAFE=1
+ * in the environment, other threads may also render with it into QImages,
+ * with widget set to nullptr, through:
+ * drawPrimitive(), drawControl(), drawComplexControl(), drawItemText(),
+ * pixelMetric(), sizeFromContents(), subElementRect(), subControlRect(),
+ * hitTestComplexControl(), styleHint() and standardPalette().
+ * Those threads get caches of their own. Everything else, including
+ * generatedIconPixmap(), polishing and setDarkMode(), stays on the GUI thread
+ * and must not run while other threads render.
+ */
 class BaseStyle : public QCommonStyle
 {
     Q_OBJECT
@@ -92,6 +108,15 @@ public:
     void polish(QWidget *widget) override;
     void unpolish(QWidget *widget) override;
 
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+public Q_SLOTS:
+    /**
+     * Switch between the light and dark palette in place, without re-creating
+     * the style and re-polishing every widget.
+     */
+    void setDarkMode(bool darkMode);
+
 protected:
     /**
      * @return Paths to application stylesheets
@@ -104,7 +129,50 @@ protected:
     BaseStylePrivate* d;
 
 private:
+    /**
+     * Polishing that is only worth doing for widgets that actually get shown:
+     * geometry changes, alert sounds and shadow registration.
+     */
+    void polishDeferred(QWidget *widget);
+
+    /**
+     * Apply the natively painted rules, fonts and remaining style sheet of the
+     * current stylesheet.qss to the application.
+     */
+    void applyStyleSheet(QApplication *app);
+
+    /**
+     * Apply the font sizes that go with the style sheet. They are derived from
+     * the application font, so they are applied again whenever that changes.
+     */
+    void applyFonts(QApplication *app);
+
+    /**
+     * Fill the caches for the first hover, popup and scroll once the
+     * application is idle after painting its first window.
+     */
+    void schedulePrewarm();
+
+    /**
+     * Render the common check box and radio button states ahead of time,
+     * for a screen with the given device pixel ratio.
+     */
+    void prewarmIndicators(qreal dpr);
+
+    /**
+     * subControlRect() without the geometry cache.
+     */
+    QRect computeSubControlRect(ComplexControl control,
+                                const QStyleOptionComplex* option,
+                                SubControl subControl,
+                                const QWidget* widget) const;
+
     ShadowHelper *m_shadowHelper;
+    PolishHelper *m_polishHelper;
+    StyleSheetLoader *m_styleSheetLoader;
+    AnimationEngine *m_animationEngine;
+    PrewarmScheduler *m_prewarmScheduler;
+    bool m_darkMode;
 };
 
 #endif
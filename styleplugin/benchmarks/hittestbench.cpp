@@ -0,0 +1,80 @@
+// Scroll bar drag benchmark for the panda style.
+//
+// Replays what a scroll bar does while its thumb is dragged: for every new
+// slider position the scroll bar is painted, which asks for the rects of its
+// sub-controls, and the mouse moves are hit tested against the same rects.
+//
+// Usage: panda-hittest-bench [positions]
+// Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include "basestyle.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QStyleOptionSlider>
+#include <QTextStream>
+
+namespace
+{
+    constexpr int Default_Positions = 100000;
+    constexpr int MovesPerPosition = 4;
+
+    const QStyle::SubControl PaintedSubControls[] = {
+        QStyle::SC_ScrollBarGroove,
+        QStyle::SC_ScrollBarSlider,
+        QStyle::SC_ScrollBarSubLine,
+        QStyle::SC_ScrollBarAddLine,
+    };
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    BaseStyle *style = new BaseStyle;
+    QApplication::setStyle(style);
+
+    const int positions = argc > 1 ? qMax(1, QByteArray(argv[1]).toInt()) : Default_Positions;
+
+    QScrollBar scrollBar(Qt::Vertical);
+    scrollBar.resize(16, 600);
+
+    QStyleOptionSlider option;
+    option.initFrom(&scrollBar);
+    option.subControls = QStyle::SC_All;
+    option.activeSubControls = QStyle::SC_ScrollBarSlider;
+    option.state |= QStyle::State_Sunken;
+    option.orientation = Qt::Vertical;
+    option.minimum = 0;
+    option.maximum = 10000;
+    option.pageStep = 500;
+    option.singleStep = 20;
+
+    // keeps the compiler from dropping the calls
+    int checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < positions; ++i) {
+        option.sliderPosition = option.sliderValue = (i * 7) % (option.maximum + 1);
+
+        for (QStyle::SubControl subControl : PaintedSubControls)
+            checksum += style->subControlRect(QStyle::CC_ScrollBar, &option, subControl, &scrollBar).height();
+
+        const QRect slider = style->subControlRect(QStyle::CC_ScrollBar, &option, QStyle::SC_ScrollBarSlider, &scrollBar);
+        for (int move = 0; move < MovesPerPosition; ++move) {
+            const QPoint pos(slider.center().x(), slider.top() + move * slider.height() / MovesPerPosition);
+            checksum += style->hitTestComplexControl(QStyle::CC_ScrollBar, &option, pos, &scrollBar);
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    QTextStream out(stdout);
+    out << "positions:          " << positions << '\n'
+        << "ns per position:    " << elapsed / positions << '\n'
+        << "checksum:           " << checksum << '\n';
+    return 0;
+}
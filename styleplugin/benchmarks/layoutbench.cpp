@@ -0,0 +1,131 @@
+// Layout benchmark for the panda style.
+//
+// Builds a widget dense dialog (tabs, a grid of form controls, a tree and a
+// button box) and measures how long it takes to create and show it, and to
+// lay it out again at a different size. Everything in a layout pass ends up
+// in BaseStyle::pixelMetric() and BaseStyle::sizeFromContents(), so this is
+// the number to compare before and after changes to the metric code.
+//
+// Usage: panda-layout-bench [iterations]
+// Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include "basestyle.h"
+
+#include <QApplication>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QSlider>
+#include <QSpinBox>
+#include <QTabWidget>
+#include <QTextStream>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    constexpr int Default_Iterations = 50;
+    constexpr int Rows = 12;
+    constexpr int Tabs = 4;
+
+    QWidget *createPage(QWidget *parent, int page)
+    {
+        QWidget *widget = new QWidget(parent);
+        QVBoxLayout *layout = new QVBoxLayout(widget);
+
+        QGroupBox *group = new QGroupBox(QStringLiteral("Settings %1").arg(page), widget);
+        QGridLayout *grid = new QGridLayout(group);
+        for (int row = 0; row < Rows; ++row) {
+            grid->addWidget(new QLabel(QStringLiteral("Option %1:").arg(row), group), row, 0);
+            grid->addWidget(new QLineEdit(QStringLiteral("value %1").arg(row), group), row, 1);
+            QComboBox *combo = new QComboBox(group);
+            combo->addItems({QStringLiteral("First"), QStringLiteral("Second"), QStringLiteral("Third")});
+            grid->addWidget(combo, row, 2);
+            grid->addWidget(new QSpinBox(group), row, 3);
+            grid->addWidget(new QCheckBox(QStringLiteral("Enabled"), group), row, 4);
+            grid->addWidget(new QRadioButton(QStringLiteral("Default"), group), row, 5);
+            grid->addWidget(new QSlider(Qt::Horizontal, group), row, 6);
+        }
+        layout->addWidget(group);
+
+        QTreeWidget *tree = new QTreeWidget(widget);
+        tree->setHeaderLabels({QStringLiteral("Name"), QStringLiteral("Size"), QStringLiteral("Type")});
+        for (int i = 0; i < 50; ++i) {
+            QTreeWidgetItem *item = new QTreeWidgetItem(tree, {QStringLiteral("Item %1").arg(i), QString::number(i * 1024), QStringLiteral("File")});
+            item->setCheckState(0, Qt::Unchecked);
+        }
+        layout->addWidget(tree);
+        return widget;
+    }
+
+    QDialog *createDialog()
+    {
+        QDialog *dialog = new QDialog;
+        QVBoxLayout *layout = new QVBoxLayout(dialog);
+        QTabWidget *tabs = new QTabWidget(dialog);
+        for (int page = 0; page < Tabs; ++page)
+            tabs->addTab(createPage(tabs, page), QStringLiteral("Page %1").arg(page));
+        layout->addWidget(tabs);
+        layout->addWidget(new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel | QDialogButtonBox::Apply, dialog));
+        return dialog;
+    }
+
+    double median(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QApplication::setStyle(new BaseStyle);
+
+    const int iterations = argc > 1 ? qMax(1, QByteArray(argv[1]).toInt()) : Default_Iterations;
+
+    std::vector<double> showSamples;
+    std::vector<double> relayoutSamples;
+    QElapsedTimer timer;
+
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        QDialog *dialog = createDialog();
+        dialog->show();
+        QApplication::processEvents();
+        showSamples.push_back(timer.nsecsElapsed() / 1e6);
+
+        // Switching pages and resizing makes the layouts ask for every size hint again
+        QTabWidget *tabs = dialog->findChild<QTabWidget *>();
+        timer.start();
+        for (int page = 0; page < Tabs; ++page) {
+            tabs->setCurrentIndex(page);
+            dialog->resize(dialog->sizeHint() + QSize(page * 10, page * 10));
+            dialog->layout()->invalidate();
+            dialog->layout()->activate();
+        }
+        relayoutSamples.push_back(timer.nsecsElapsed() / 1e6);
+
+        delete dialog;
+    }
+
+    QTextStream out(stdout);
+    out << "iterations:       " << iterations << '\n'
+        << "create + show ms: " << median(showSamples) << " (median)\n"
+        << "relayout ms:      " << median(relayoutSamples) << " (median)\n";
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Shadow pipeline benchmark and golden image check for the panda style.
+//
+// Renders the window shadow of every size class in ShadowHelper at several
+// device pixel ratios and frame radii, and times the three steps that make up
+// a shadow separately: BoxShadowRenderer::render() with the window area masked
+// out, cutting the texture into a TileSet, and turning the eight border tiles
+// into KWindowShadowTiles.
+//
+// With --record, the alpha channel of every texture is written to the given
+// directory as a grayscale PNG. With --compare, every texture is checked
+// against those images, and the exit code is 1 if any pixel differs by more
+// than the tolerance. Record with the reference implementation, then compare
+// with the changed one.
+//
+// Usage: panda-shadow-bench [--iterations N] [--record DIR | --compare DIR] [--tolerance ALPHA]
+// Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include "shadowhelper.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QTextStream>
+
+namespace
+{
+    constexpr int Default_Iterations = 20;
+    constexpr int Default_Tolerance = 2;
+
+    const int SizeClasses[] = {ShadowHelper::ShadowSmall, ShadowHelper::ShadowMedium,
+                               ShadowHelper::ShadowLarge, ShadowHelper::ShadowVeryLarge};
+    const char *const SizeNames[] = {"none", "small", "medium", "large", "verylarge"};
+    const qreal DevicePixelRatios[] = {1.0, 1.25, 1.5, 2.0, 3.0};
+    const qreal FrameRadii[] = {0.0, 5.0};
+
+    // The border tiles in the order ShadowHelper::installShadows() hands them over
+    const int BorderTiles[] = {1, 2, 5, 8, 7, 6, 3, 0};
+
+    QImage alphaChannel(const QImage &texture)
+    {
+        const QImage source = texture.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QImage alpha(source.size(), QImage::Format_Grayscale8);
+        for (int y = 0; y < source.height(); ++y) {
+            const QRgb *in = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            uchar *out = alpha.scanLine(y);
+            for (int x = 0; x < source.width(); ++x)
+                out[x] = uchar(qAlpha(in[x]));
+        }
+        return alpha;
+    }
+
+    // Largest difference between two alpha images, or -1 if their sizes differ
+    int maxDifference(const QImage &a, const QImage &b)
+    {
+        if (a.size() != b.size())
+            return -1;
+        int result = 0;
+        for (int y = 0; y < a.height(); ++y) {
+            const uchar *lineA = a.constScanLine(y);
+            const uchar *lineB = b.constScanLine(y);
+            for (int x = 0; x < a.width(); ++x)
+                result = qMax(result, qAbs(int(lineA[x]) - int(lineB[x])));
+        }
+        return result;
+    }
+
+    template <typename Function>
+    qint64 timePerCall(int iterations, Function function)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            function();
+        return timer.nsecsElapsed() / iterations;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    int iterations = Default_Iterations;
+    int tolerance = Default_Tolerance;
+    QString recordDir;
+    QString compareDir;
+    const QStringList arguments = QCoreApplication::arguments();
+    for (int i = 1; i + 1 < arguments.size(); i += 2) {
+        const QString &name = arguments.at(i);
+        const QString &value = arguments.at(i + 1);
+        if (name == QLatin1String("--iterations"))
+            iterations = qMax(1, value.toInt());
+        else if (name == QLatin1String("--tolerance"))
+            tolerance = qMax(0, value.toInt());
+        else if (name == QLatin1String("--record"))
+            recordDir = value;
+        else if (name == QLatin1String("--compare"))
+            compareDir = value;
+    }
+    if (!recordDir.isEmpty())
+        QDir().mkpath(recordDir);
+
+    QTextStream out(stdout);
+    out.setFieldAlignment(QTextStream::AlignLeft);
+    out << "size       dpr   radius  render ns  tileset ns  tiles ns  golden\n";
+
+    int failures = 0;
+    for (int sizeClass : SizeClasses) {
+        const CompositeShadowParams params = ShadowHelper::lookupShadowParams(sizeClass);
+        for (qreal dpr : DevicePixelRatios) {
+            for (qreal radius : FrameRadii) {
+                const QImage texture = ShadowHelper::renderShadowTexture(params, radius, dpr);
+                const TileSet tiles = ShadowHelper::shadowTilesFromTexture(texture);
+
+                const qint64 renderTime = timePerCall(iterations, [&] {
+                    ShadowHelper::renderShadowTexture(params, radius, dpr);
+                });
+                const qint64 tileSetTime = timePerCall(iterations, [&] {
+                    ShadowHelper::shadowTilesFromTexture(texture);
+                });
+                const qint64 tilesTime = timePerCall(iterations, [&] {
+                    for (int tile : BorderTiles)
+                        ShadowHelper::createTile(tiles.pixmap(tile));
+                });
+
+                const QString fileName = QStringLiteral("shadow-%1-dpr%2-radius%3.png")
+                    .arg(QLatin1String(SizeNames[sizeClass]))
+                    .arg(qRound(dpr * 100))
+                    .arg(qRound(radius));
+                const QImage alpha = alphaChannel(texture);
+
+                QString golden = QStringLiteral("-");
+                if (!recordDir.isEmpty()) {
+                    golden = alpha.save(QDir(recordDir).filePath(fileName)) ? QStringLiteral("recorded")
+                                                                            : QStringLiteral("write failed");
+                } else if (!compareDir.isEmpty()) {
+                    const QImage reference(QDir(compareDir).filePath(fileName));
+                    const int difference = reference.isNull()
+                        ? -1 : maxDifference(alpha, reference.convertToFormat(QImage::Format_Grayscale8));
+                    if (reference.isNull())
+                        golden = QStringLiteral("missing");
+                    else if (difference < 0)
+                        golden = QStringLiteral("size differs");
+                    else
+                        golden = QStringLiteral("max diff %1").arg(difference);
+                    if (difference < 0 || difference > tolerance) {
+                        golden += QStringLiteral(" FAIL");
+                        ++failures;
+                    }
+                }
+
+                out << qSetFieldWidth(11) << SizeNames[sizeClass]
+                    << qSetFieldWidth(6) << dpr
+                    << qSetFieldWidth(8) << radius
+                    << qSetFieldWidth(11) << renderTime
+                    << qSetFieldWidth(12) << tileSetTime
+                    << qSetFieldWidth(10) << tilesTime
+                    << qSetFieldWidth(0) << golden << '\n';
+            }
+        }
+    }
+
+    if (!compareDir.isEmpty())
+        out << "failures: " << failures << '\n';
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,436 @@
+// Painting benchmark for the panda style.
+//
+// Draws every primitive element, control element and complex control that
+// BaseStyle paints itself, in the normal, hovered, pressed and disabled
+// states, at two sizes, at device pixel ratios 1 and 2, and with the light and
+// dark palettes. Prints one JSON record per combination with the time and the
+// number of heap allocations per call, for comparing releases. With glibc every
+// malloc() is counted (mallocs_per_op), elsewhere only operator new
+// (operator_new_per_op).
+//
+// Usage: panda-style-bench [iterations] [filter]
+// Only elements whose name contains filter are run.
+// Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include "basestyle.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QStyleOption>
+#include <QTextStream>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace
+{
+    std::atomic<quint64> allocations {0};
+}
+
+#if defined(__GLIBC__)
+// Qt 5 allocates QString, QByteArray, QVector and QImage storage with malloc()
+// directly, so allocations are counted there. Defining these in the executable
+// takes every malloc(), calloc() and realloc() of the process, Qt's included,
+// and operator new ends up here too.
+#define ALLOCATIONS_FIELD "mallocs_per_op"
+
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+#else
+// Without a portable way to wrap malloc() only operator new is counted, which
+// misses what Qt allocates with malloc(); the field name says so.
+#define ALLOCATIONS_FIELD "operator_new_per_op"
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+namespace
+{
+    constexpr int Default_Iterations = 200;
+    constexpr int Warmup_Iterations = 5;
+
+    enum Kind {
+        Primitive,
+        Control,
+        Complex,
+    };
+
+    struct Case
+    {
+        QString name;
+        Kind kind;
+        int element;
+        QSize size;
+        std::unique_ptr<QStyleOption> option;
+    };
+
+    struct StateVariant
+    {
+        const char *name;
+        QStyle::State state;
+        QPalette::ColorGroup group;
+    };
+
+    const StateVariant States[] = {
+        {"normal", QStyle::State_Enabled | QStyle::State_Active | QStyle::State_Raised, QPalette::Active},
+        {"hover", QStyle::State_Enabled | QStyle::State_Active | QStyle::State_MouseOver, QPalette::Active},
+        {"pressed", QStyle::State_Enabled | QStyle::State_Active | QStyle::State_Sunken | QStyle::State_On, QPalette::Active},
+        {"disabled", QStyle::State_None, QPalette::Disabled},
+    };
+
+    template <typename Option, typename Init>
+    std::unique_ptr<QStyleOption> makeOption(Init init)
+    {
+        auto option = std::make_unique<Option>();
+        init(*option);
+        return option;
+    }
+
+    template <typename Option>
+    std::unique_ptr<QStyleOption> makeOption()
+    {
+        return std::make_unique<Option>();
+    }
+
+    std::vector<Case> makeCases()
+    {
+        std::vector<Case> cases;
+        auto add = [&](const char *name, Kind kind, int element, QSize size, std::unique_ptr<QStyleOption> option) {
+            cases.push_back(Case {QString::fromLatin1(name), kind, element, size, std::move(option)});
+        };
+        const QSize indicator(16, 16);
+        const QSize button(96, 24);
+        const QSize panel(160, 96);
+
+        auto buttonOption = [] {
+            return makeOption<QStyleOptionButton>([](QStyleOptionButton &o) { o.text = QStringLiteral("&Button"); });
+        };
+        auto frameOption = [](QFrame::Shape shape = QFrame::StyledPanel) {
+            return makeOption<QStyleOptionFrame>([shape](QStyleOptionFrame &o) {
+                o.lineWidth = 1;
+                o.frameShape = shape;
+            });
+        };
+        auto viewItemOption = [] {
+            return makeOption<QStyleOptionViewItem>([](QStyleOptionViewItem &o) {
+                o.text = QStringLiteral("Item");
+                o.features = QStyleOptionViewItem::HasDisplay | QStyleOptionViewItem::HasCheckIndicator;
+                o.checkState = Qt::Checked;
+                o.showDecorationSelected = true;
+            });
+        };
+        auto menuItemOption = [](QStyleOptionMenuItem::MenuItemType type) {
+            return makeOption<QStyleOptionMenuItem>([type](QStyleOptionMenuItem &o) {
+                o.menuItemType = type;
+                o.text = QStringLiteral("&Open Recent\tCtrl+O");
+                o.checkType = QStyleOptionMenuItem::NonExclusive;
+                o.checked = true;
+            });
+        };
+        auto toolButtonOption = [] {
+            return makeOption<QStyleOptionToolButton>([](QStyleOptionToolButton &o) {
+                o.text = QStringLiteral("Tool");
+                o.subControls = QStyle::SC_ToolButton | QStyle::SC_ToolButtonMenu;
+                o.features = QStyleOptionToolButton::MenuButtonPopup;
+                o.toolButtonStyle = Qt::ToolButtonTextOnly;
+            });
+        };
+        auto sliderOption = [](Qt::Orientation orientation) {
+            return makeOption<QStyleOptionSlider>([orientation](QStyleOptionSlider &o) {
+                o.orientation = orientation;
+                if (orientation == Qt::Horizontal)
+                    o.state |= QStyle::State_Horizontal;
+                o.subControls = QStyle::SC_All;
+                o.maximum = 100;
+                o.sliderPosition = o.sliderValue = 40;
+                o.pageStep = 10;
+                o.tickPosition = QSlider::TicksBelow;
+                o.tickInterval = 10;
+            });
+        };
+        auto progressOption = [] {
+            return makeOption<QStyleOptionProgressBar>([](QStyleOptionProgressBar &o) {
+                o.maximum = 100;
+                o.progress = 60;
+                o.text = QStringLiteral("60%");
+                o.textVisible = true;
+            });
+        };
+        auto headerOption = [] {
+            return makeOption<QStyleOptionHeader>([](QStyleOptionHeader &o) {
+                o.text = QStringLiteral("Name");
+                o.sortIndicator = QStyleOptionHeader::SortDown;
+                o.position = QStyleOptionHeader::Middle;
+            });
+        };
+        auto tabOption = [] {
+            return makeOption<QStyleOptionTab>([](QStyleOptionTab &o) {
+                o.text = QStringLiteral("Document");
+                o.position = QStyleOptionTab::Middle;
+            });
+        };
+        auto comboOption = [] {
+            return makeOption<QStyleOptionComboBox>([](QStyleOptionComboBox &o) {
+                o.currentText = QStringLiteral("Choice");
+                o.subControls = QStyle::SC_All;
+                o.frame = true;
+            });
+        };
+
+        add("PE_Frame", Primitive, QStyle::PE_Frame, panel, frameOption());
+        add("PE_FrameDefaultButton", Primitive, QStyle::PE_FrameDefaultButton, button, buttonOption());
+        add("PE_FrameDockWidget", Primitive, QStyle::PE_FrameDockWidget, panel, frameOption());
+        add("PE_FrameFocusRect", Primitive, QStyle::PE_FrameFocusRect, button, makeOption<QStyleOptionFocusRect>());
+        add("PE_FrameGroupBox", Primitive, QStyle::PE_FrameGroupBox, panel, frameOption());
+        add("PE_FrameLineEdit", Primitive, QStyle::PE_FrameLineEdit, button, frameOption());
+        add("PE_FrameMenu", Primitive, QStyle::PE_FrameMenu, panel, frameOption());
+        add("PE_FrameStatusBarItem", Primitive, QStyle::PE_FrameStatusBarItem, button, frameOption());
+        add("PE_FrameTabBarBase", Primitive, QStyle::PE_FrameTabBarBase, button, makeOption<QStyleOptionTabBarBase>());
+        add("PE_FrameTabWidget", Primitive, QStyle::PE_FrameTabWidget, panel, makeOption<QStyleOptionTabWidgetFrame>());
+        add("PE_FrameWindow", Primitive, QStyle::PE_FrameWindow, panel, frameOption());
+        add("PE_IndicatorArrowDown", Primitive, QStyle::PE_IndicatorArrowDown, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorArrowLeft", Primitive, QStyle::PE_IndicatorArrowLeft, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorArrowRight", Primitive, QStyle::PE_IndicatorArrowRight, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorArrowUp", Primitive, QStyle::PE_IndicatorArrowUp, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorBranch", Primitive, QStyle::PE_IndicatorBranch, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorButtonDropDown", Primitive, QStyle::PE_IndicatorButtonDropDown, indicator, toolButtonOption());
+        add("PE_IndicatorCheckBox", Primitive, QStyle::PE_IndicatorCheckBox, indicator, buttonOption());
+        add("PE_IndicatorDockWidgetResizeHandle", Primitive, QStyle::PE_IndicatorDockWidgetResizeHandle, button, makeOption<QStyleOption>());
+        add("PE_IndicatorHeaderArrow", Primitive, QStyle::PE_IndicatorHeaderArrow, indicator, headerOption());
+        add("PE_IndicatorItemViewItemCheck", Primitive, QStyle::PE_IndicatorItemViewItemCheck, indicator, viewItemOption());
+        add("PE_IndicatorMenuCheckMark", Primitive, QStyle::PE_IndicatorMenuCheckMark, indicator, menuItemOption(QStyleOptionMenuItem::Normal));
+        add("PE_IndicatorRadioButton", Primitive, QStyle::PE_IndicatorRadioButton, indicator, buttonOption());
+        add("PE_IndicatorTabClose", Primitive, QStyle::PE_IndicatorTabClose, indicator, makeOption<QStyleOption>());
+        add("PE_IndicatorToolBarHandle", Primitive, QStyle::PE_IndicatorToolBarHandle, QSize(8, 24), makeOption<QStyleOption>());
+        add("PE_IndicatorToolBarSeparator", Primitive, QStyle::PE_IndicatorToolBarSeparator, QSize(8, 24), makeOption<QStyleOption>());
+        add("PE_PanelButtonBevel", Primitive, QStyle::PE_PanelButtonBevel, button, buttonOption());
+        add("PE_PanelButtonCommand", Primitive, QStyle::PE_PanelButtonCommand, button, buttonOption());
+        add("PE_PanelButtonTool", Primitive, QStyle::PE_PanelButtonTool, button, toolButtonOption());
+        add("PE_PanelItemViewItem", Primitive, QStyle::PE_PanelItemViewItem, button, viewItemOption());
+        add("PE_PanelItemViewRow", Primitive, QStyle::PE_PanelItemViewRow, button, viewItemOption());
+        add("PE_PanelLineEdit", Primitive, QStyle::PE_PanelLineEdit, button, frameOption());
+        add("PE_PanelMenu", Primitive, QStyle::PE_PanelMenu, panel, frameOption());
+        add("PE_PanelScrollAreaCorner", Primitive, QStyle::PE_PanelScrollAreaCorner, indicator, makeOption<QStyleOption>());
+        add("PE_PanelStatusBar", Primitive, QStyle::PE_PanelStatusBar, button, makeOption<QStyleOption>());
+        add("PE_PanelTipLabel", Primitive, QStyle::PE_PanelTipLabel, button, frameOption());
+
+        add("CE_CheckBox", Control, QStyle::CE_CheckBox, button, buttonOption());
+        add("CE_RadioButton", Control, QStyle::CE_RadioButton, button, buttonOption());
+        add("CE_PushButton", Control, QStyle::CE_PushButton, button, buttonOption());
+        add("CE_PushButtonLabel", Control, QStyle::CE_PushButtonLabel, button, buttonOption());
+        add("CE_ComboBoxLabel", Control, QStyle::CE_ComboBoxLabel, button, comboOption());
+        add("CE_DockWidgetTitle", Control, QStyle::CE_DockWidgetTitle, button,
+            makeOption<QStyleOptionDockWidget>([](QStyleOptionDockWidget &o) {
+                o.title = QStringLiteral("Properties");
+                o.closable = true;
+                o.floatable = true;
+            }));
+        add("CE_Header", Control, QStyle::CE_Header, button, headerOption());
+        add("CE_HeaderLabel", Control, QStyle::CE_HeaderLabel, button, headerOption());
+        add("CE_HeaderSection", Control, QStyle::CE_HeaderSection, button, headerOption());
+        add("CE_ItemViewItem", Control, QStyle::CE_ItemViewItem, button, viewItemOption());
+        add("CE_MenuBarEmptyArea", Control, QStyle::CE_MenuBarEmptyArea, panel, menuItemOption(QStyleOptionMenuItem::EmptyArea));
+        add("CE_MenuBarItem", Control, QStyle::CE_MenuBarItem, button, menuItemOption(QStyleOptionMenuItem::Normal));
+        add("CE_MenuEmptyArea", Control, QStyle::CE_MenuEmptyArea, panel, menuItemOption(QStyleOptionMenuItem::EmptyArea));
+        add("CE_MenuHMargin", Control, QStyle::CE_MenuHMargin, button, menuItemOption(QStyleOptionMenuItem::Margin));
+        add("CE_MenuItem", Control, QStyle::CE_MenuItem, QSize(200, 24), menuItemOption(QStyleOptionMenuItem::Normal));
+        add("CE_MenuItem_SubMenu", Control, QStyle::CE_MenuItem, QSize(200, 24), menuItemOption(QStyleOptionMenuItem::SubMenu));
+        add("CE_MenuItem_Separator", Control, QStyle::CE_MenuItem, QSize(200, 8), menuItemOption(QStyleOptionMenuItem::Separator));
+        add("CE_MenuVMargin", Control, QStyle::CE_MenuVMargin, button, menuItemOption(QStyleOptionMenuItem::Margin));
+        add("CE_ProgressBar", Control, QStyle::CE_ProgressBar, button, progressOption());
+        add("CE_ProgressBarContents", Control, QStyle::CE_ProgressBarContents, button, progressOption());
+        add("CE_ProgressBarGroove", Control, QStyle::CE_ProgressBarGroove, button, progressOption());
+        add("CE_ProgressBarLabel", Control, QStyle::CE_ProgressBarLabel, button, progressOption());
+        add("CE_RubberBand", Control, QStyle::CE_RubberBand, panel,
+            makeOption<QStyleOptionRubberBand>([](QStyleOptionRubberBand &o) {
+                o.shape = QRubberBand::Rectangle;
+                o.opaque = false;
+            }));
+        add("CE_ShapedFrame", Control, QStyle::CE_ShapedFrame, panel, frameOption(QFrame::HLine));
+        add("CE_SizeGrip", Control, QStyle::CE_SizeGrip, indicator,
+            makeOption<QStyleOptionSizeGrip>([](QStyleOptionSizeGrip &o) { o.corner = Qt::BottomRightCorner; }));
+        add("CE_Splitter", Control, QStyle::CE_Splitter, QSize(6, 96), makeOption<QStyleOption>());
+        add("CE_TabBarTabShape", Control, QStyle::CE_TabBarTabShape, button, tabOption());
+        add("CE_TabBarTabLabel", Control, QStyle::CE_TabBarTabLabel, button, tabOption());
+        add("CE_ToolBar", Control, QStyle::CE_ToolBar, QSize(320, 32), makeOption<QStyleOptionToolBar>());
+        add("CE_ToolButtonLabel", Control, QStyle::CE_ToolButtonLabel, button, toolButtonOption());
+
+        add("CC_ComboBox", Complex, QStyle::CC_ComboBox, QSize(120, 24), comboOption());
+        add("CC_Dial", Complex, QStyle::CC_Dial, QSize(48, 48), sliderOption(Qt::Horizontal));
+        add("CC_GroupBox", Complex, QStyle::CC_GroupBox, panel,
+            makeOption<QStyleOptionGroupBox>([](QStyleOptionGroupBox &o) {
+                o.text = QStringLiteral("Options");
+                o.subControls = QStyle::SC_GroupBoxFrame | QStyle::SC_GroupBoxLabel | QStyle::SC_GroupBoxCheckBox;
+                o.textAlignment = Qt::AlignLeft;
+            }));
+        add("CC_ScrollBar", Complex, QStyle::CC_ScrollBar, QSize(14, 160), sliderOption(Qt::Vertical));
+        add("CC_Slider", Complex, QStyle::CC_Slider, QSize(160, 24), sliderOption(Qt::Horizontal));
+        add("CC_SpinBox", Complex, QStyle::CC_SpinBox, QSize(96, 24),
+            makeOption<QStyleOptionSpinBox>([](QStyleOptionSpinBox &o) {
+                o.subControls = QStyle::SC_All;
+                o.frame = true;
+                o.stepEnabled = QAbstractSpinBox::StepUpEnabled | QAbstractSpinBox::StepDownEnabled;
+            }));
+        add("CC_TitleBar", Complex, QStyle::CC_TitleBar, QSize(320, 24),
+            makeOption<QStyleOptionTitleBar>([](QStyleOptionTitleBar &o) {
+                o.text = QStringLiteral("Untitled Document");
+                o.subControls = QStyle::SC_All;
+                o.titleBarFlags = Qt::Window | Qt::WindowTitleHint | Qt::WindowSystemMenuHint
+                    | Qt::WindowMinMaxButtonsHint | Qt::WindowCloseButtonHint;
+            }));
+        add("CC_ToolButton", Complex, QStyle::CC_ToolButton, button, toolButtonOption());
+        return cases;
+    }
+
+    void draw(QStyle *style, const Case &c, QPainter *painter)
+    {
+        switch (c.kind) {
+        case Primitive:
+            style->drawPrimitive(QStyle::PrimitiveElement(c.element), c.option.get(), painter);
+            break;
+        case Control:
+            style->drawControl(QStyle::ControlElement(c.element), c.option.get(), painter);
+            break;
+        case Complex:
+            style->drawComplexControl(QStyle::ComplexControl(c.element),
+                                      static_cast<const QStyleOptionComplex *>(c.option.get()), painter);
+            break;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    BaseStyle *style = new BaseStyle;
+    QApplication::setStyle(style);
+
+    const int iterations = argc > 1 ? qMax(1, QByteArray(argv[1]).toInt()) : Default_Iterations;
+    const QString filter = argc > 2 ? QString::fromLocal8Bit(argv[2]) : QString();
+
+    std::vector<Case> cases = makeCases();
+    QJsonArray results;
+
+    for (bool dark : {false, true}) {
+        style->setDarkMode(dark);
+        const QPalette palette = style->standardPalette();
+
+        for (const qreal dpr : {1.0, 2.0}) {
+            for (Case &c : cases) {
+                if (!filter.isEmpty() && !c.name.contains(filter))
+                    continue;
+
+                for (const int scale : {1, 2}) {
+                    const QSize size = c.size * scale;
+                    QImage image(size * dpr, QImage::Format_ARGB32_Premultiplied);
+                    image.setDevicePixelRatio(dpr);
+                    image.fill(Qt::transparent);
+                    QPainter painter(&image);
+
+                    for (const StateVariant &variant : States) {
+                        QStyleOption &option = *c.option;
+                        option.palette = palette;
+                        option.palette.setCurrentColorGroup(variant.group);
+                        option.state = variant.state | (option.state & QStyle::State_Horizontal);
+                        option.rect = QRect(QPoint(0, 0), size);
+                        option.fontMetrics = QFontMetrics(QApplication::font());
+
+                        for (int i = 0; i < Warmup_Iterations; ++i)
+                            draw(style, c, &painter);
+
+                        const quint64 allocationsBefore = allocations.load(std::memory_order_relaxed);
+                        QElapsedTimer timer;
+                        timer.start();
+                        for (int i = 0; i < iterations; ++i)
+                            draw(style, c, &painter);
+                        const qint64 elapsed = timer.nsecsElapsed();
+                        const quint64 allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+                        results.append(QJsonObject {
+                            {QStringLiteral("element"), c.name},
+                            {QStringLiteral("state"), QLatin1String(variant.name)},
+                            {QStringLiteral("palette"), dark ? QStringLiteral("dark") : QStringLiteral("light")},
+                            {QStringLiteral("dpr"), dpr},
+                            {QStringLiteral("width"), size.width()},
+                            {QStringLiteral("height"), size.height()},
+                            {QStringLiteral("ns_per_op"), double(elapsed) / iterations},
+                            {QStringLiteral(ALLOCATIONS_FIELD), double(allocated) / iterations},
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    const QJsonObject report {
+        {QStringLiteral("qt_version"), QLatin1String(qVersion())},
+        {QStringLiteral("iterations"), iterations},
+        {QStringLiteral("results"), results},
+    };
+    QTextStream out(stdout);
+    out << QJsonDocument(report).toJson(QJsonDocument::Indented);
+    return 0;
+}
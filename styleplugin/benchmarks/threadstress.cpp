@@ -0,0 +1,169 @@
+// Thread-safe mode stress test for the panda style.
+//
+// Renders every primitive element, plus the common controls and complex
+// controls with matching options, into QImages from several threads at once.
+// Run it under ThreadSanitizer to look for data races; on its own it checks
+// that the threads agree on what they painted.
+//
+// Usage: panda-thread-stress [threads] [rounds]
+// Runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include "basestyle.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOption>
+#include <QTextStream>
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int Default_Rounds = 20;
+    const QSize ImageSize(64, 32);
+
+    // Rendering the same things must give the same pixels in every thread
+    quint64 renderAll(QStyle *style, const QPalette &palette)
+    {
+        QImage image(ImageSize, QImage::Format_ARGB32_Premultiplied);
+        quint64 checksum = 0;
+        auto accumulate = [&] {
+            for (int y = 0; y < image.height(); ++y) {
+                const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+                for (int x = 0; x < image.width(); ++x)
+                    checksum = checksum * 31 + line[x];
+            }
+        };
+
+        for (int pe = QStyle::PE_Frame; pe <= QStyle::PE_PanelMenu; ++pe) {
+            for (QStyle::State state : {QStyle::State_Enabled | QStyle::State_On,
+                                        QStyle::State_Enabled | QStyle::State_Sunken,
+                                        QStyle::State_None}) {
+                QStyleOptionButton option;
+                option.palette = palette;
+                option.rect = QRect(QPoint(2, 2), QSize(16, 16));
+                option.state = state;
+                image.fill(Qt::transparent);
+                QPainter painter(&image);
+                style->drawPrimitive(QStyle::PrimitiveElement(pe), &option, &painter);
+                painter.end();
+                accumulate();
+            }
+        }
+
+        QStyleOptionButton button;
+        button.palette = palette;
+        button.rect = QRect(QPoint(0, 0), ImageSize);
+        button.state = QStyle::State_Enabled;
+        button.text = QStringLiteral("&Button");
+        QStyleOptionProgressBar progressBar;
+        progressBar.palette = palette;
+        progressBar.rect = button.rect;
+        progressBar.minimum = 0;
+        progressBar.maximum = 100;
+        progressBar.progress = 42;
+        QStyleOptionHeader header;
+        header.palette = palette;
+        header.rect = button.rect;
+        header.text = QStringLiteral("Header");
+        QStyleOptionMenuItem menuItem;
+        menuItem.palette = palette;
+        menuItem.rect = button.rect;
+        menuItem.text = QStringLiteral("Menu item\tCtrl+M");
+        menuItem.menuItemType = QStyleOptionMenuItem::Normal;
+        menuItem.checkType = QStyleOptionMenuItem::NonExclusive;
+        menuItem.checked = true;
+        const std::pair<QStyle::ControlElement, const QStyleOption *> controls[] = {
+            {QStyle::CE_PushButton, &button},
+            {QStyle::CE_CheckBox, &button},
+            {QStyle::CE_RadioButton, &button},
+            {QStyle::CE_ProgressBar, &progressBar},
+            {QStyle::CE_Header, &header},
+            {QStyle::CE_MenuItem, &menuItem},
+        };
+        for (const auto &control : controls) {
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            style->drawControl(control.first, control.second, &painter);
+            painter.end();
+            accumulate();
+        }
+
+        QStyleOptionSlider slider;
+        slider.palette = palette;
+        slider.rect = button.rect;
+        slider.state = QStyle::State_Enabled | QStyle::State_Horizontal;
+        slider.orientation = Qt::Horizontal;
+        slider.subControls = QStyle::SC_All;
+        slider.maximum = 100;
+        slider.sliderPosition = slider.sliderValue = 30;
+        slider.pageStep = 10;
+        QStyleOptionSpinBox spinBox;
+        spinBox.palette = palette;
+        spinBox.rect = button.rect;
+        spinBox.subControls = QStyle::SC_All;
+        spinBox.frame = true;
+        QStyleOptionComboBox comboBox;
+        comboBox.palette = palette;
+        comboBox.rect = button.rect;
+        comboBox.subControls = QStyle::SC_All;
+        comboBox.currentText = QStringLiteral("Combo");
+        const std::pair<QStyle::ComplexControl, const QStyleOptionComplex *> complexControls[] = {
+            {QStyle::CC_ScrollBar, &slider},
+            {QStyle::CC_Slider, &slider},
+            {QStyle::CC_SpinBox, &spinBox},
+            {QStyle::CC_ComboBox, &comboBox},
+        };
+        for (const auto &control : complexControls) {
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            style->drawComplexControl(control.first, control.second, &painter);
+            painter.end();
+            accumulate();
+            checksum += style->hitTestComplexControl(control.first, control.second, QPoint(10, 10));
+        }
+        return checksum;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    qputenv("PANDA_STYLE_THREADSAFE", "1");
+
+    QApplication app(argc, argv);
+    BaseStyle *style = new BaseStyle;
+    QApplication::setStyle(style);
+    const QPalette palette = style->standardPalette();
+
+    const int threadCount = argc > 1 ? qMax(1, QByteArray(argv[1]).toInt()) : int(std::thread::hardware_concurrency());
+    const int rounds = argc > 2 ? qMax(1, QByteArray(argv[2]).toInt()) : Default_Rounds;
+
+    const quint64 expected = renderAll(style, palette);
+
+    std::vector<quint64> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&, i] {
+            quint64 result = 0;
+            for (int round = 0; round < rounds; ++round)
+                result |= renderAll(style, palette) ^ expected;
+            results[i] = result;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    int failures = 0;
+    for (quint64 result : results)
+        failures += result != 0;
+
+    QTextStream out(stdout);
+    out << "threads:  " << threadCount << '\n'
+        << "rounds:   " << rounds << '\n'
+        << "mismatch: " << failures << '\n';
+    return failures == 0 ? 0 : 1;
+}
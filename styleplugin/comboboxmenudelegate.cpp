@@ -0,0 +1,105 @@
+#include "comboboxmenudelegate.h"
+
+#include <QApplication>
+#include <QComboBox>
+#include <QIcon>
+#include <QPainter>
+#include <QPixmap>
+
+ComboBoxMenuDelegate::ComboBoxMenuDelegate(QComboBox *combo)
+    : QAbstractItemDelegate(combo),
+      m_combo(combo)
+{
+}
+
+void ComboBoxMenuDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QStyleOptionMenuItem menuOption = menuItemOption(option, index);
+    painter->fillRect(option.rect, menuOption.palette.window());
+    m_combo->style()->drawControl(QStyle::CE_MenuItem, &menuOption, painter, m_combo);
+}
+
+QSize ComboBoxMenuDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QStyleOptionMenuItem menuOption = menuItemOption(option, index);
+    return m_combo->style()->sizeFromContents(QStyle::CT_MenuItem, &menuOption, option.rect.size(), m_combo);
+}
+
+QStyleOptionMenuItem ComboBoxMenuDelegate::menuItemOption(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionMenuItem menuOption;
+
+    QPalette palette = option.palette.resolve(QApplication::palette("QMenu"));
+    const QVariant foreground = index.data(Qt::ForegroundRole);
+    if (foreground.canConvert<QBrush>()) {
+        const QBrush brush = qvariant_cast<QBrush>(foreground);
+        palette.setBrush(QPalette::WindowText, brush);
+        palette.setBrush(QPalette::ButtonText, brush);
+        palette.setBrush(QPalette::Text, brush);
+    }
+    menuOption.palette = palette;
+
+    menuOption.state = QStyle::State_None;
+    if (m_combo->window()->isActiveWindow())
+        menuOption.state = QStyle::State_Active;
+    if ((option.state & QStyle::State_Enabled) && (index.model()->flags(index) & Qt::ItemIsEnabled))
+        menuOption.state |= QStyle::State_Enabled;
+    else
+        menuOption.palette.setCurrentColorGroup(QPalette::Disabled);
+    if (option.state & QStyle::State_Selected)
+        menuOption.state |= QStyle::State_Selected;
+
+    // a valid check state means that the model has checkable items
+    menuOption.checkType = QStyleOptionMenuItem::NonExclusive;
+    const QVariant checkState = index.data(Qt::CheckStateRole);
+    if (!checkState.isValid()) {
+        menuOption.checked = m_combo->currentIndex() == index.row();
+    } else {
+        menuOption.checked = checkState.toInt() == Qt::Checked;
+        menuOption.state |= menuOption.checked ? QStyle::State_On : QStyle::State_Off;
+    }
+
+    // QComboBox::insertSeparator() marks its rows this way
+    if (index.data(Qt::AccessibleDescriptionRole).toString() == QLatin1String("separator"))
+        menuOption.menuItemType = QStyleOptionMenuItem::Separator;
+    else
+        menuOption.menuItemType = QStyleOptionMenuItem::Normal;
+
+    const QVariant decoration = index.data(Qt::DecorationRole);
+    switch (decoration.userType()) {
+    case QMetaType::QIcon:
+        menuOption.icon = qvariant_cast<QIcon>(decoration);
+        break;
+    case QMetaType::QColor: {
+        QPixmap pixmap(option.decorationSize);
+        pixmap.fill(qvariant_cast<QColor>(decoration));
+        menuOption.icon = pixmap;
+        break;
+    }
+    default:
+        menuOption.icon = qvariant_cast<QPixmap>(decoration);
+        break;
+    }
+
+    const QVariant background = index.data(Qt::BackgroundRole);
+    if (background.canConvert<QBrush>())
+        menuOption.palette.setBrush(QPalette::All, QPalette::Window, qvariant_cast<QBrush>(background));
+
+    menuOption.text = index.data(Qt::DisplayRole).toString().replace(QLatin1Char('&'), QLatin1String("&&"));
+    menuOption.tabWidth = 0;
+    menuOption.maxIconWidth = option.decorationSize.width() + 4;
+    menuOption.menuRect = option.rect;
+    menuOption.rect = option.rect;
+
+    // fonts set on the model or on the combo box, in that order, win over the menu font
+    const QVariant font = index.data(Qt::FontRole);
+    if (font.isValid())
+        menuOption.font = qvariant_cast<QFont>(font);
+    else if (m_combo->testAttribute(Qt::WA_SetFont) || m_combo->font() != QApplication::font("QComboBox"))
+        menuOption.font = m_combo->font();
+    else
+        menuOption.font = QApplication::font("QComboMenuItem");
+    menuOption.fontMetrics = QFontMetrics(menuOption.font);
+
+    return menuOption;
+}
@@ -0,0 +1,38 @@
+#ifndef COMBOBOXMENUDELEGATE_H
+#define COMBOBOXMENUDELEGATE_H
+
+#include <QAbstractItemDelegate>
+#include <QStyleOptionMenuItem>
+
+class QComboBox;
+
+//* paints combo box rows as menu items in the dropdown list
+/**
+Qt's QComboMenuDelegate is private, and QComboBox replaces it with a plain item
+delegate as soon as SH_ComboBox_Popup asks for the dropdown list. This does what
+QComboMenuDelegate does: rows are painted with CE_MenuItem and measured with
+CT_MenuItem, so long combo boxes look the same as short ones in their popup.
+QComboBox only swaps its own delegates, so this one stays put.
+*/
+class ComboBoxMenuDelegate : public QAbstractItemDelegate
+{
+    Q_OBJECT
+
+public:
+    //* constructor
+    explicit ComboBoxMenuDelegate(QComboBox *combo);
+
+    //* paint row as a menu item
+    void paint(QPainter *, const QStyleOptionViewItem &, const QModelIndex &) const override;
+
+    //* size of row as a menu item
+    QSize sizeHint(const QStyleOptionViewItem &, const QModelIndex &) const override;
+
+private:
+    //* menu item option for row, as QComboMenuDelegate builds it
+    QStyleOptionMenuItem menuItemOption(const QStyleOptionViewItem &, const QModelIndex &) const;
+
+    QComboBox *m_combo;
+};
+
+#endif // COMBOBOXMENUDELEGATE_H
@@ -0,0 +1,159 @@
+#include "paintprofiler.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDebug>
+#include <QMetaEnum>
+#include <QStyle>
+#include <QVector>
+
+#include <algorithm>
+
+PaintProfiler *PaintProfiler::s_instance = nullptr;
+
+namespace
+{
+    const char Object_Path[] = "/StyleProfiler";
+
+    QString serviceName()
+    {
+        return QStringLiteral("org.panda.StyleProfiler.pid%1").arg(QCoreApplication::applicationPid());
+    }
+
+    QString elementName(PaintProfiler::Kind kind, int element)
+    {
+        QMetaEnum metaEnum;
+        switch (kind) {
+        case PaintProfiler::Primitive:
+            metaEnum = QMetaEnum::fromType<QStyle::PrimitiveElement>();
+            break;
+        case PaintProfiler::Control:
+            metaEnum = QMetaEnum::fromType<QStyle::ControlElement>();
+            break;
+        default:
+            metaEnum = QMetaEnum::fromType<QStyle::ComplexControl>();
+            break;
+        }
+        if (const char *key = metaEnum.valueToKey(element))
+            return QLatin1String(key);
+        return QStringLiteral("%1(%2)").arg(QLatin1String(metaEnum.name())).arg(element);
+    }
+
+    QString hitRate(quint64 hits, quint64 misses)
+    {
+        const quint64 total = hits + misses;
+        return total ? QString::number(100.0 * hits / total, 'f', 1) + QLatin1Char('%') : QStringLiteral("-");
+    }
+}
+
+void PaintProfiler::createIfEnabled(QObject *style)
+{
+    if (s_instance || qEnvironmentVariable("PANDA_STYLE_PROFILE") != QLatin1String("1"))
+        return;
+
+    s_instance = new PaintProfiler(style);
+}
+
+PaintProfiler::PaintProfiler(QObject *parent)
+    : QObject(parent)
+{
+    Reset();
+
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, [this] {
+            qInfo().noquote() << Report();
+        });
+    }
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (bus.isConnected()) {
+        bus.registerService(serviceName());
+        bus.registerObject(QLatin1String(Object_Path), this, QDBusConnection::ExportScriptableSlots);
+    }
+}
+
+PaintProfiler::~PaintProfiler()
+{
+    if (s_instance == this)
+        s_instance = nullptr;
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (bus.isConnected()) {
+        bus.unregisterObject(QLatin1String(Object_Path));
+        bus.unregisterService(serviceName());
+    }
+}
+
+void PaintProfiler::record(Kind kind, int element, qint64 nsecs)
+{
+    Slot &slot = m_slots[kind][qBound(0, element, NumElements - 1)];
+    slot.calls.fetch_add(1, std::memory_order_relaxed);
+    slot.nsecs.fetch_add(quint64(nsecs), std::memory_order_relaxed);
+}
+
+QString PaintProfiler::Report() const
+{
+    struct Row
+    {
+        QString name;
+        quint64 calls;
+        quint64 nsecs;
+    };
+    QVector<Row> rows;
+    for (int kind = 0; kind < NumKinds; ++kind) {
+        for (int element = 0; element < NumElements; ++element) {
+            const Slot &slot = m_slots[kind][element];
+            const quint64 calls = slot.calls.load(std::memory_order_relaxed);
+            if (calls == 0)
+                continue;
+            const QString name = element == NumElements - 1
+                ? elementName(Kind(kind), element) + QStringLiteral(" and above")
+                : elementName(Kind(kind), element);
+            rows.append(Row {name, calls, slot.nsecs.load(std::memory_order_relaxed)});
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.nsecs > b.nsecs; });
+
+    QString report;
+    report += QStringLiteral("panda style paint profile of %1\n").arg(QCoreApplication::applicationName());
+    report += QStringLiteral("%1 %2 %3 %4\n")
+        .arg(QStringLiteral("element"), -36)
+        .arg(QStringLiteral("calls"), 10)
+        .arg(QStringLiteral("total ms"), 10)
+        .arg(QStringLiteral("avg us"), 8);
+    for (const Row &row : rows) {
+        report += QStringLiteral("%1 %2 %3 %4\n")
+            .arg(row.name, -36)
+            .arg(row.calls, 10)
+            .arg(row.nsecs / 1e6, 10, 'f', 2)
+            .arg(row.nsecs / 1e3 / row.calls, 8, 'f', 2);
+    }
+
+    auto counter = [this](Counter c) { return m_counters[c].load(std::memory_order_relaxed); };
+    report += QStringLiteral("swatches: %1 fast path, %2 cache hits, %3 misses, %4 hit rate\n")
+        .arg(counter(SwatchFastHit))
+        .arg(counter(SwatchHit))
+        .arg(counter(SwatchMiss))
+        .arg(hitRate(counter(SwatchFastHit) + counter(SwatchHit), counter(SwatchMiss)));
+    report += QStringLiteral("indicator atlas: %1 hits, %2 misses, %3 hit rate\n")
+        .arg(counter(IndicatorAtlasHit))
+        .arg(counter(IndicatorAtlasMiss))
+        .arg(hitRate(counter(IndicatorAtlasHit), counter(IndicatorAtlasMiss)));
+    report += QStringLiteral("icon pixmaps: %1 hits, %2 misses, %3 hit rate\n")
+        .arg(counter(IconCacheHit))
+        .arg(counter(IconCacheMiss))
+        .arg(hitRate(counter(IconCacheHit), counter(IconCacheMiss)));
+    return report;
+}
+
+void PaintProfiler::Reset()
+{
+    for (auto &kind : m_slots) {
+        for (Slot &slot : kind) {
+            slot.calls.store(0, std::memory_order_relaxed);
+            slot.nsecs.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (std::atomic<quint64> &counter : m_counters)
+        counter.store(0, std::memory_order_relaxed);
+}
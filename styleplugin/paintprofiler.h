@@ -0,0 +1,111 @@
+#ifndef PAINTPROFILER_H
+#define PAINTPROFILER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <atomic>
+
+//* counts style paint calls and cache hits, enabled with PANDA_STYLE_PROFILE=1
+/**
+every drawPrimitive(), drawControl() and drawComplexControl() call is counted
+and timed per element; the times include nested calls, so a control that draws
+primitives also carries their time. Swatch, indicator atlas and icon cache
+lookups are counted as hits and misses.
+
+the report is printed to stderr when the application quits, and can be read
+(and the counters reset) at any time over the session bus:
+qdbus org.panda.StyleProfiler.pid<pid> /StyleProfiler Report
+
+while disabled there is no profiler instance, and every hook is one predicted
+branch on a null pointer.
+*/
+class PaintProfiler : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.panda.StyleProfiler")
+
+public:
+    enum Kind {
+        Primitive,
+        Control,
+        Complex,
+        NumKinds
+    };
+
+    enum Counter {
+        SwatchFastHit,
+        SwatchHit,
+        SwatchMiss,
+        IndicatorAtlasHit,
+        IndicatorAtlasMiss,
+        IconCacheHit,
+        IconCacheMiss,
+        NumCounters
+    };
+
+    //* starts profiling if PANDA_STYLE_PROFILE=1, parented to the style
+    static void createIfEnabled(QObject *style);
+
+    //* destructor
+    ~PaintProfiler() override;
+
+    //* count a cache lookup
+    static void count(Counter counter)
+    {
+        if (Q_UNLIKELY(s_instance))
+            s_instance->m_counters[counter].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //* times one draw call from construction to destruction
+    class Scope
+    {
+    public:
+        Scope(Kind kind, int element)
+            : m_kind(kind),
+              m_element(element)
+        {
+            if (Q_UNLIKELY(s_instance))
+                m_timer.start();
+        }
+
+        ~Scope()
+        {
+            if (Q_UNLIKELY(s_instance))
+                s_instance->record(m_kind, m_element, m_timer.nsecsElapsed());
+        }
+
+    private:
+        Kind m_kind;
+        int m_element;
+        QElapsedTimer m_timer;
+    };
+
+public Q_SLOTS:
+    //* calls, time and cache hit rates so far, as text
+    Q_SCRIPTABLE QString Report() const;
+
+    //* start counting from zero
+    Q_SCRIPTABLE void Reset();
+
+private:
+    explicit PaintProfiler(QObject *parent);
+
+    void record(Kind kind, int element, qint64 nsecs);
+
+    static PaintProfiler *s_instance;
+
+    // One slot per enum value, the last one collects the custom elements
+    static constexpr int NumElements = 64;
+
+    struct Slot
+    {
+        std::atomic<quint64> calls {0};
+        std::atomic<quint64> nsecs {0};
+    };
+
+    Slot m_slots[NumKinds][NumElements];
+    std::atomic<quint64> m_counters[NumCounters];
+};
+
+#endif // PAINTPROFILER_H
@@ -0,0 +1,96 @@
+#include "polishhelper.h"
+
+#include <QEvent>
+#include <QVector>
+#include <QWidget>
+
+PolishHelper::PolishHelper(const PolishFunction &function, QObject *parent)
+    : QObject(parent),
+      m_function(function)
+{
+}
+
+void PolishHelper::registerWidget(QWidget *widget)
+{
+    // nothing to wait for
+    if (widget->isVisible()) {
+        m_function(widget);
+        return;
+    }
+
+    if (m_pending.contains(widget))
+        return;
+
+    m_pending.insert(widget);
+    widget->installEventFilter(this);
+    connect(widget, &QObject::destroyed, this, &PolishHelper::objectDeleted, Qt::UniqueConnection);
+
+    // The window gets its native handle right before its layout is activated for
+    // the first show, so flushing there applies all geometry changes in that pass.
+    QWidget *window = widget->window();
+    if (window != widget && !m_windows.contains(window)) {
+        m_windows.insert(window);
+        window->installEventFilter(this);
+        connect(window, &QObject::destroyed, this, &PolishHelper::objectDeleted, Qt::UniqueConnection);
+    }
+}
+
+void PolishHelper::unregisterWidget(QWidget *widget)
+{
+    if (m_pending.remove(widget)) {
+        if (!m_windows.contains(widget)) {
+            widget->removeEventFilter(this);
+            disconnect(widget, nullptr, this, nullptr);
+        }
+    }
+}
+
+bool PolishHelper::eventFilter(QObject *object, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::WinIdChange:
+    case QEvent::Show: {
+        QWidget *widget = static_cast<QWidget *>(object);
+        flush(widget->window());
+        break;
+    }
+    default:
+        break;
+    }
+
+    // never eat events
+    return false;
+}
+
+void PolishHelper::objectDeleted(QObject *object)
+{
+    QWidget *widget = static_cast<QWidget *>(object);
+    m_pending.remove(widget);
+    m_windows.remove(widget);
+}
+
+void PolishHelper::flush(QWidget *window)
+{
+    QVector<QWidget *> batch;
+    for (QWidget *widget : qAsConst(m_pending)) {
+        if (widget->window() != window)
+            continue;
+
+        // widgets on hidden pages stay queued until their page is shown
+        if (widget != window && !widget->isVisibleTo(window))
+            continue;
+
+        batch.append(widget);
+    }
+
+    for (QWidget *widget : qAsConst(batch)) {
+        m_pending.remove(widget);
+        if (!m_windows.contains(widget)) {
+            widget->removeEventFilter(this);
+            disconnect(widget, nullptr, this, nullptr);
+        }
+    }
+
+    for (QWidget *widget : qAsConst(batch))
+        m_function(widget);
+}
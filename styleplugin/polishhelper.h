@@ -0,0 +1,55 @@
+#ifndef POLISHHELPER_H
+#define POLISHHELPER_H
+
+#include <QObject>
+#include <QSet>
+
+#include <functional>
+
+class QWidget;
+
+//* defers the expensive part of widget polishing until right before the widget is first shown
+/**
+widgets are queued when the style polishes them and processed in one batch per window,
+either when the window gets its native handle (before its layout is activated for the
+first show) or when one of the queued widgets receives its show event. Widgets that are
+created and destroyed without ever being shown never get their deferred polish.
+*/
+class PolishHelper : public QObject
+{
+    Q_OBJECT
+
+public:
+    using PolishFunction = std::function<void(QWidget *)>;
+
+    //* constructor
+    PolishHelper(const PolishFunction &function, QObject *parent = nullptr);
+
+    //* queue widget, or polish it right away if it is already visible
+    void registerWidget(QWidget *);
+
+    //* remove widget from the queue without polishing it
+    void unregisterWidget(QWidget *);
+
+    //* event filter
+    bool eventFilter(QObject *, QEvent *) override;
+
+protected Q_SLOTS:
+    //* unregister widget
+    void objectDeleted(QObject *);
+
+protected:
+    //* polish all queued widgets of the given window that will be visible with it
+    void flush(QWidget *window);
+
+private:
+    PolishFunction m_function;
+
+    //* widgets waiting for their deferred polish
+    QSet<QWidget *> m_pending;
+
+    //* windows watched for native window creation
+    QSet<QWidget *> m_windows;
+};
+
+#endif // POLISHHELPER_H
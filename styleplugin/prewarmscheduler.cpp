@@ -0,0 +1,84 @@
+#include "prewarmscheduler.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QTimerEvent>
+#include <QWidget>
+
+namespace
+{
+    // Longest stretch of tasks between two trips through the event loop, in ms
+    const int Slice_Budget = 4;
+
+    // Most time all tasks together may take, in ms
+    const int Total_Budget = 100;
+}
+
+PrewarmScheduler::PrewarmScheduler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void PrewarmScheduler::schedule(const QVector<Task> &tasks)
+{
+    cancel();
+    if (tasks.isEmpty() || !QCoreApplication::instance())
+        return;
+
+    m_tasks = tasks;
+    m_spent = 0;
+    QCoreApplication::instance()->installEventFilter(this);
+}
+
+void PrewarmScheduler::cancel()
+{
+    m_tasks.clear();
+    m_timer.stop();
+    if (QCoreApplication::instance())
+        QCoreApplication::instance()->removeEventFilter(this);
+}
+
+bool PrewarmScheduler::eventFilter(QObject *object, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::Paint:
+        // the zero timer fires once the frame being painted has been flushed
+        if (!m_timer.isActive() && object->isWidgetType() && static_cast<QWidget *>(object)->isWindow())
+            m_timer.start(0, this);
+        break;
+
+    case QEvent::KeyPress:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::Wheel:
+    case QEvent::TouchBegin:
+        // the user is here, leave the event loop to them
+        cancel();
+        break;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+void PrewarmScheduler::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_timer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    while (!m_tasks.isEmpty() && slice.elapsed() < Slice_Budget) {
+        const Task task = m_tasks.takeFirst();
+        task();
+    }
+    m_spent += slice.nsecsElapsed();
+
+    if (m_tasks.isEmpty() || m_spent >= qint64(Total_Budget) * 1000000)
+        cancel();
+}
@@ -0,0 +1,53 @@
+#ifndef PREWARMSCHEDULER_H
+#define PREWARMSCHEDULER_H
+
+#include <QBasicTimer>
+#include <QObject>
+#include <QVector>
+
+#include <functional>
+
+//* fills the style caches while the application is idle after its first frame
+/**
+the first hover, popup or scroll of a new process would otherwise pay for
+deriving swatches, blurring shadows and rasterizing indicators. Tasks are run
+one after another from a zero timer, so input and repaints still get through
+between them, only after a top level window has painted once, and within a
+time budget. Any key press, click or wheel turn cancels what is left: from
+then on the caches fill up as usual.
+*/
+class PrewarmScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Task = std::function<void()>;
+
+    //* constructor
+    explicit PrewarmScheduler(QObject *parent = nullptr);
+
+    //* run tasks, in order, once the application has painted its first window
+    /** replaces the tasks of an earlier call that did not finish */
+    void schedule(const QVector<Task> &tasks);
+
+    //* drop the tasks that did not run yet
+    void cancel();
+
+    //* event filter
+    bool eventFilter(QObject *, QEvent *) override;
+
+protected:
+    void timerEvent(QTimerEvent *) override;
+
+private:
+    //* tasks still to run
+    QVector<Task> m_tasks;
+
+    //* time spent running tasks so far, in nanoseconds
+    qint64 m_spent = 0;
+
+    //* runs the tasks once the first frame is out
+    QBasicTimer m_timer;
+};
+
+#endif // PREWARMSCHEDULER_H
@@ -1,5 +1,6 @@
 #include "pstyleplugin.h"
 #include "basestyle.h"
+#include "startuptrace.h"
 
 #include <QApplication>
 #include <QStyleFactory>
@@ -16,5 +17,6 @@ QStyle *ProxyStylePlugin::create(const QString &key)
         return nullptr;
     }
 
+    StartupTrace::Scope trace("ProxyStylePlugin::create");
     return new BaseStyle;
 }
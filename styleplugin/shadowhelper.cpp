@@ -29,7 +29,9 @@
 #include <QPainter>
 #include <QPixmap>
 #include <QPlatformSurfaceEvent>
+#include <QScreen>
 #include <QToolBar>
+#include <QWindow>
 #include <QTextStream>
 
 #include <KWindowSystem>
@@ -37,14 +39,7 @@
 const char netWMSkipShadow[] = "_PANDA_NET_WM_SKIP_SHADOW";
 const char netWMForceShadow[] = "_PANDA_NET_WM_FORCE_SHADOW";
 const char netWMFrameRadius[] = "_PANDA_NET_WM_FRAME_RADIUS";
-
-enum {
-    ShadowNone,
-    ShadowSmall,
-    ShadowMedium,
-    ShadowLarge,
-    ShadowVeryLarge
-};
+const char netWMShadowSize[] = "_PANDA_NET_WM_SHADOW_SIZE";
 
 const CompositeShadowParams s_shadowParams[] = {
     // None
@@ -76,6 +71,8 @@ ShadowHelper::ShadowHelper(QObject * parent)
     : QObject(parent),
       m_frameRadius(5)
 {
+    if (qGuiApp)
+        connect(qGuiApp, &QGuiApplication::screenRemoved, this, &ShadowHelper::pruneShadowTiles);
 }
 
 ShadowHelper::~ShadowHelper()
@@ -111,12 +108,7 @@ bool ShadowHelper::registerWidget(QWidget *widget, bool force)
     if (!(force || acceptWidget(widget)))
         return false;
 
-    qreal frameRadius = m_frameRadius;
-    const auto frameRadiusProperty = widget->property(netWMFrameRadius);
-    if (frameRadiusProperty.isValid())
-        frameRadius = frameRadiusProperty.toReal();
-
-    installShadows(widget, shadowTiles(frameRadius));
+    updateShadows(widget);
     m_widgets.insert(widget);
 
     // install event filter
@@ -148,14 +140,7 @@ bool ShadowHelper::eventFilter(QObject *object, QEvent *event)
     if (KWindowSystem::isPlatformX11()) {
         // check event type
         if (event->type() == QEvent::WinIdChange) {
-            QWidget *widget = static_cast<QWidget *>(object);
-
-            qreal frameRadius = m_frameRadius;
-            const auto frameRadiusProperty = widget->property(netWMFrameRadius);
-            if (frameRadiusProperty.isValid())
-                frameRadius = frameRadiusProperty.toReal();
-            TileSet shadowTileSet = shadowTiles(frameRadius);
-            installShadows(widget, shadowTileSet);
+            updateShadows(static_cast<QWidget *>(object));
         }
     } else {
         if (event->type() != QEvent::PlatformSurface)
@@ -177,15 +162,108 @@ bool ShadowHelper::eventFilter(QObject *object, QEvent *event)
     return false;
 }
 
-TileSet ShadowHelper::shadowTiles(const qreal frameRadius)
+void ShadowHelper::updateShadows(QWidget *widget)
+{
+    const ShadowSize size = shadowSize(widget);
+    if (size == ShadowNone) {
+        uninstallShadows(widget);
+        return;
+    }
+
+    qreal frameRadius = m_frameRadius;
+    const auto frameRadiusProperty = widget->property(netWMFrameRadius);
+    if (frameRadiusProperty.isValid())
+        frameRadius = frameRadiusProperty.toReal();
+
+    // the ratio of the screen the window is on, not the highest of all screens
+    installShadows(widget, size, frameRadius, widget->devicePixelRatioF());
+}
+
+ShadowHelper::ShadowSize ShadowHelper::shadowSize(QWidget *widget) const
 {
-    const CompositeShadowParams params = lookupShadowParams(ShadowVeryLarge);
+    bool ok = false;
+    const int size = widget->property(netWMShadowSize).toInt(&ok);
+    if (ok && size >= ShadowNone && size <= ShadowVeryLarge)
+        return ShadowSize(size);
+
+    // the most frequent popups get the smallest, cheapest shadows
+    if (isToolTip(widget) || widget->inherits("QComboBoxPrivateContainer"))
+        return ShadowSmall;
+    if (isMenu(widget))
+        return ShadowMedium;
+    if (isDockWidget(widget) || isToolBar(widget))
+        return ShadowLarge;
+    return ShadowVeryLarge;
+}
 
+void ShadowHelper::windowScreenChanged()
+{
+    const QWindow *window = qobject_cast<QWindow *>(sender());
+    for (QWidget *widget : qAsConst(m_widgets)) {
+        if (widget->windowHandle() == window) {
+            updateShadows(widget);
+            return;
+        }
+    }
+}
+
+QVector<qreal> ShadowHelper::screenDevicePixelRatios()
+{
+    QVector<qreal> ratios;
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    for (const QScreen *screen : screens) {
+        if (!ratios.contains(screen->devicePixelRatio()))
+            ratios.append(screen->devicePixelRatio());
+    }
+    if (ratios.isEmpty())
+        ratios.append(qApp->devicePixelRatio());
+    return ratios;
+}
+
+void ShadowHelper::pruneShadowTiles()
+{
+    QSet<int> ratios;
+    for (qreal ratio : screenDevicePixelRatios())
+        ratios.insert(qRound(ratio * 100));
+
+    for (auto it = m_shadowTiles.begin(); it != m_shadowTiles.end();) {
+        if (ratios.contains(it.key().devicePixelRatio))
+            ++it;
+        else
+            it = m_shadowTiles.erase(it);
+    }
+}
+
+TileSet ShadowHelper::shadowTiles(int shadowSize, const qreal frameRadius, qreal dpr)
+{
+    return cachedShadowTiles(shadowSize, frameRadius, dpr).tileSet;
+}
+
+ShadowHelper::ShadowTiles &ShadowHelper::cachedShadowTiles(int shadowSize, qreal frameRadius, qreal dpr)
+{
+    const ShadowTilesKey key {shadowSize, qRound(frameRadius * 100), qRound(dpr * 100)};
+
+    auto it = m_shadowTiles.find(key);
+    if (it != m_shadowTiles.end())
+        return it.value();
+
+    // only a handful of sizes and radii are in use, anything beyond that is churn
+    if (m_shadowTiles.size() >= 16) {
+        pruneShadowTiles();
+        if (m_shadowTiles.size() >= 16)
+            m_shadowTiles.clear();
+    }
+
+    const QImage texture = renderShadowTexture(lookupShadowParams(shadowSize), frameRadius, dpr);
+    ShadowTiles tiles;
+    tiles.tileSet = shadowTilesFromTexture(texture);
+    return m_shadowTiles.insert(key, tiles).value();
+}
+
+QImage ShadowHelper::renderShadowTexture(const CompositeShadowParams &params, qreal frameRadius, qreal dpr)
+{
     if (params.isNone())
-        return TileSet();
-    // } else if (_shadowTiles.isValid()) {
-    //     return _shadowTiles;
-    // }
+        return QImage();
 
     auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
         QColor c(color);
@@ -200,8 +278,6 @@ TileSet ShadowHelper::shadowTiles(const qreal frameRadius)
     const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
         .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
 
-    const qreal dpr = qApp->devicePixelRatio();
-
     BoxShadowRenderer shadowRenderer;
     shadowRenderer.setBorderRadius(frameRadius);
     shadowRenderer.setBoxSize(boxSize);
@@ -241,6 +317,15 @@ TileSet ShadowHelper::shadowTiles(const qreal frameRadius)
     // We're done.
     painter.end();
 
+    return shadowTexture;
+}
+
+TileSet ShadowHelper::shadowTilesFromTexture(const QImage &shadowTexture)
+{
+    if (shadowTexture.isNull())
+        return TileSet();
+
+    const QRect outerRect(QPoint(0, 0), shadowTexture.size() / shadowTexture.devicePixelRatio());
     const QPoint innerRectTopLeft = outerRect.center();
     TileSet tiles = TileSet(
         QPixmap::fromImage(shadowTexture),
@@ -313,7 +398,7 @@ KWindowShadowTile::Ptr ShadowHelper::createTile(const QPixmap& source)
     return tile;
 }
 
-void ShadowHelper::installShadows(QWidget *widget, TileSet shadowTiles)
+void ShadowHelper::installShadows(QWidget *widget, ShadowSize size, qreal frameRadius, qreal dpr)
 {
     if (!widget)
         return;
@@ -326,26 +411,45 @@ void ShadowHelper::installShadows(QWidget *widget, TileSet shadowTiles)
     if (!widget->testAttribute(Qt::WA_WState_Created))
         return;
 
-    // create platform shadow tiles
-    QVector<KWindowShadowTile::Ptr> tiles = {
-        createTile(shadowTiles.pixmap(1)),
-        createTile(shadowTiles.pixmap(2)),
-        createTile(shadowTiles.pixmap(5)),
-        createTile(shadowTiles.pixmap(8)),
-        createTile(shadowTiles.pixmap(7)),
-        createTile(shadowTiles.pixmap(6)),
-        createTile(shadowTiles.pixmap(3)),
-        createTile(shadowTiles.pixmap(0))
-    };
+    // platform shadow tiles are created once and shared by all windows, so the
+    // window manager gets the pixmaps only once per process
+    ShadowTiles &shadowTiles = cachedShadowTiles(size, frameRadius, dpr);
+    if (shadowTiles.platformTiles.isEmpty() && shadowTiles.tileSet.isValid()) {
+        shadowTiles.platformTiles = {
+            createTile(shadowTiles.tileSet.pixmap(1)),
+            createTile(shadowTiles.tileSet.pixmap(2)),
+            createTile(shadowTiles.tileSet.pixmap(5)),
+            createTile(shadowTiles.tileSet.pixmap(8)),
+            createTile(shadowTiles.tileSet.pixmap(7)),
+            createTile(shadowTiles.tileSet.pixmap(6)),
+            createTile(shadowTiles.tileSet.pixmap(3)),
+            createTile(shadowTiles.tileSet.pixmap(0))
+        };
+    }
+    const QVector<KWindowShadowTile::Ptr> tiles = shadowTiles.platformTiles;
     if (tiles.count() != numTiles)
         return;
 
+    const QMargins padding = shadowMargins(widget, size, dpr);
+
     // find a shadow associated with the widget
-    KWindowShadow*& shadow = m_shadows[ widget ];
+    InstalledShadow &installed = m_shadows[ widget ];
+    KWindowShadow*& shadow = installed.shadow;
 
     if (!shadow)
         shadow = new KWindowShadow(widget);
 
+    // nothing to do if the native window already has this very shadow
+    const WId winId = widget->internalWinId();
+    if (shadow->isCreated()
+        && installed.winId == winId
+        && shadow->window() == widget->windowHandle()
+        && shadow->topTile() == tiles[ 0 ]
+        && shadow->padding() == padding)
+        return;
+
+    // a new native window only needs the properties set again, the tiles
+    // are already uploaded
     if (shadow->isCreated())
         shadow->destroy();
 
@@ -357,14 +461,19 @@ void ShadowHelper::installShadows(QWidget *widget, TileSet shadowTiles)
     shadow->setBottomLeftTile(tiles[ 5 ]);
     shadow->setLeftTile(tiles[ 6 ]);
     shadow->setTopLeftTile(tiles[ 7 ]);
-    shadow->setPadding(shadowMargins(widget, shadowTiles));
+    shadow->setPadding(padding);
     shadow->setWindow(widget->windowHandle());
     shadow->create();
+    installed.winId = winId;
+
+    // moving to a screen with another device pixel ratio needs other tiles
+    connect(widget->windowHandle(), &QWindow::screenChanged,
+            this, &ShadowHelper::windowScreenChanged, Qt::UniqueConnection);
 }
 
-QMargins ShadowHelper::shadowMargins(QWidget *widget, TileSet shadowTiles) const
+QMargins ShadowHelper::shadowMargins(QWidget *widget, ShadowSize size, qreal dpr) const
 {
-    const CompositeShadowParams params = lookupShadowParams(ShadowVeryLarge);
+    const CompositeShadowParams params = lookupShadowParams(size);
     if (params.isNone())
         return QMargins();
 
@@ -403,12 +512,12 @@ QMargins ShadowHelper::shadowMargins(QWidget *widget, TileSet shadowTiles) const
         }
     }
 
-    margins *= shadowTiles.pixmap(0).devicePixelRatio();
+    margins *= dpr;
 
     return margins;
 }
 
 void ShadowHelper::uninstallShadows(QWidget *widget)
 {
-    delete m_shadows.take(widget);
+    delete m_shadows.take(widget).shadow;
 }
@@ -25,6 +25,7 @@
 #include "tileset.h"
 #include <KWindowShadow>
 
+#include <QHash>
 #include <QObject>
 #include <QPointer>
 #include <QMap>
@@ -72,6 +73,15 @@ class ShadowHelper: public QObject
     Q_OBJECT
 
 public:
+    //* shadow size classes, also the values of the _PANDA_NET_WM_SHADOW_SIZE property
+    enum ShadowSize {
+        ShadowNone,
+        ShadowSmall,
+        ShadowMedium,
+        ShadowLarge,
+        ShadowVeryLarge
+    };
+
     //* constructor
     ShadowHelper(QObject *);
 
@@ -96,12 +106,30 @@ public:
     /** is public because it is also needed for mdi windows */
     // TileSet shadowTiles();
 
-    TileSet shadowTiles(const qreal frameRadius);
+    TileSet shadowTiles(int shadowSize, const qreal frameRadius, qreal devicePixelRatio);
+
+    //* device pixel ratios of the connected screens, each once
+    static QVector<qreal> screenDevicePixelRatios();
+
+    //* shadow texture for the given params, with the window area masked out
+    static QImage renderShadowTexture(const CompositeShadowParams &, qreal frameRadius, qreal devicePixelRatio);
+
+    //* cut a shadow texture into tiles around its center
+    static TileSet shadowTilesFromTexture(const QImage &);
+
+    // create shadow tile from pixmap
+    static KWindowShadowTile::Ptr createTile(const QPixmap &);
 
 protected Q_SLOTS:
     //* unregister widget
     void objectDeleted(QObject *);
 
+    //* install shadows at the device pixel ratio of the window's new screen
+    void windowScreenChanged();
+
+    //* drop shadow tiles for device pixel ratios no screen uses anymore
+    void pruneShadowTiles();
+
 protected:
     //* true if widget is a menu
     bool isMenu(QWidget *) const;
@@ -118,29 +146,69 @@ protected:
     //* accept widget
     bool acceptWidget(QWidget *) const;
 
-    // create shadow tile from pixmap
-    KWindowShadowTile::Ptr createTile(const QPixmap &);
+    //* installs the shadow matching the widget's type, frame radius and screen
+    void updateShadows(QWidget *);
+
+    //* shadow size class of widget, from its type unless set as a property
+    ShadowSize shadowSize(QWidget *) const;
 
     //* installs shadow on given widget in a platform independent way
     // void installShadows( QWidget * );
 
-    void installShadows(QWidget *widget, TileSet shadowTiles);
+    void installShadows(QWidget *widget, ShadowSize size, qreal frameRadius, qreal devicePixelRatio);
 
     //* uninstalls shadow on given widget in a platform independent way
     void uninstallShadows(QWidget *);
 
     //* gets the shadow margins for the given widget
-    QMargins shadowMargins(QWidget*, TileSet) const;
+    QMargins shadowMargins(QWidget*, ShadowSize size, qreal devicePixelRatio) const;
 
 private:
     //* registered widgets
     QSet<QWidget *> m_widgets;
 
+    //* a window's shadow and the native window it was created for
+    struct InstalledShadow
+    {
+        KWindowShadow *shadow = nullptr;
+        WId winId = 0;
+    };
+
     //* managed shadows
-    QMap<QWidget *, KWindowShadow *> m_shadows;
+    QMap<QWidget *, InstalledShadow> m_shadows;
 
     qreal m_frameRadius;
 
+    //* rendered shadow tiles and the platform tiles made from them
+    struct ShadowTiles
+    {
+        TileSet tileSet;
+        QVector<KWindowShadowTile::Ptr> platformTiles;
+    };
+
+    //* shadow tiles for size class, frame radius and device pixel ratio, rendered on first use
+    ShadowTiles &cachedShadowTiles(int shadowSize, qreal frameRadius, qreal devicePixelRatio);
+
+    //* size class, with frame radius and device pixel ratio in hundredths
+    struct ShadowTilesKey
+    {
+        int shadowSize;
+        int frameRadius;
+        int devicePixelRatio;
+
+        bool operator==(const ShadowTilesKey &other) const
+        {
+            return shadowSize == other.shadowSize
+                && frameRadius == other.frameRadius
+                && devicePixelRatio == other.devicePixelRatio;
+        }
+    };
+    friend uint qHash(const ShadowTilesKey &key, uint seed)
+    { return ::qHash(qMakePair(key.frameRadius, key.devicePixelRatio), seed) ^ uint(key.shadowSize); }
+
+    //* shadow tiles of every size class, frame radius and device pixel ratio in use
+    QHash<ShadowTilesKey, ShadowTiles> m_shadowTiles;
+
     //* number of tiles
     enum { numTiles = 8 };
 };
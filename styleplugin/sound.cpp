@@ -1,29 +1,125 @@
 #include "sound.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QtMultimedia/QSound>
+#include <QHash>
+#include <QPointer>
+#include <QThread>
+#include <QUrl>
+#include <QtMultimedia/QSoundEffect>
 #include <QDebug>
 #include <QStandardPaths>
 
+namespace {
 
-void sound::playSound(QString wav)
+// Triggers of the same sound closer together than this are played only once
+constexpr qint64 DuplicateSound_Interval = 150;
+
+// Owns the audio thread. Everything below m_worker, including the path cache
+// and the decoded effects, is only ever touched from that thread, so the GUI
+// thread never waits on the file system or the sound server.
+class SoundEngine
 {
-    // probono: Play wav because it is lowest latency
-    // QSound::play("://sounds/EmptyTrash.wav"); // FIXME: Cannot get this to play from a resource
+public:
+    SoundEngine()
+    {
+        m_thread.setObjectName(QStringLiteral("panda-sound"));
+        m_worker = new QObject;
+        m_worker->moveToThread(&m_thread);
+        QObject::connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+        m_thread.start(QThread::LowPriority);
+
+        if (QCoreApplication *app = QCoreApplication::instance())
+            QObject::connect(app, &QCoreApplication::aboutToQuit, m_worker, [this] { stop(); }, Qt::DirectConnection);
+    }
+
+    ~SoundEngine()
+    {
+        stop();
+    }
 
-    QString soundFile = nullptr;
-    QStringList locationCandidates =  QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
-    foreach (QString locationCandidate, locationCandidates) {
-        if(QFile::exists(locationCandidate + "/panda/sounds/" + wav)) {
-            soundFile = locationCandidate + "/panda/sounds/" + wav;
+    void preload(const QString &wav)
+    {
+        if (!m_worker)
+            return;
+        QMetaObject::invokeMethod(m_worker, [this, wav] { effect(wav); }, Qt::QueuedConnection);
+    }
+
+    void play(const QString &wav)
+    {
+        if (!m_worker)
+            return;
+        QMetaObject::invokeMethod(m_worker, [this, wav] {
+            QSoundEffect *soundEffect = effect(wav);
+            if (!soundEffect)
+                return;
+
+            QElapsedTimer &lastPlayed = m_lastPlayed[wav];
+            if (lastPlayed.isValid() && !lastPlayed.hasExpired(DuplicateSound_Interval))
+                return;
+            lastPlayed.start();
+
+            // A queued play() starts as soon as a still loading effect is ready
+            soundEffect->play();
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    void stop()
+    {
+        if (m_thread.isRunning()) {
+            m_thread.quit();
+            m_thread.wait();
         }
     }
 
-    if(soundFile != nullptr) {
-        QSound::play(soundFile);
-    } else {
-        qDebug() << "Sound not found";
+    // Audio thread only
+    QSoundEffect *effect(const QString &wav)
+    {
+        auto it = m_effects.constFind(wav);
+        if (it != m_effects.constEnd())
+            return it.value();
+
+        QString soundFile;
+        const QStringList locationCandidates = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+        for (const QString &locationCandidate : locationCandidates) {
+            if (QFile::exists(locationCandidate + "/panda/sounds/" + wav)) {
+                soundFile = locationCandidate + "/panda/sounds/" + wav;
+            }
+        }
+
+        // Misses are cached too, so a missing file is only looked up once
+        QSoundEffect *soundEffect = nullptr;
+        if (!soundFile.isEmpty()) {
+            soundEffect = new QSoundEffect(m_worker);
+            soundEffect->setSource(QUrl::fromLocalFile(soundFile));
+        } else {
+            qDebug() << "Sound not found" << wav;
+        }
+
+        m_effects.insert(wav, soundEffect);
+        return soundEffect;
     }
 
+    QThread m_thread;
+    QPointer<QObject> m_worker;
+    QHash<QString, QSoundEffect *> m_effects;
+    QHash<QString, QElapsedTimer> m_lastPlayed;
+};
+
+Q_GLOBAL_STATIC(SoundEngine, s_soundEngine)
+
+}
+
+void sound::preload(const QString &wav)
+{
+    s_soundEngine->preload(wav);
+}
+
+void sound::playSound(QString wav)
+{
+    // probono: Play wav because it is lowest latency
+    // QSound::play("://sounds/EmptyTrash.wav"); // FIXME: Cannot get this to play from a resource
+    s_soundEngine->play(wav);
 }
@@ -6,6 +6,9 @@
 class sound
 {
 public:
+    // Resolve and decode a sound ahead of time so that playing it later is instant
+    static void preload(const QString &wav);
+
     static void playSound(QString wav);
 };
 
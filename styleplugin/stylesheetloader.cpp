@@ -0,0 +1,117 @@
+#include "stylesheetloader.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QStandardPaths>
+
+namespace
+{
+    // Shared by all style instances of the process
+    QHash<QString, StyleSheetLoader::Result> &resultCache()
+    {
+        static QHash<QString, StyleSheetLoader::Result> cache;
+        return cache;
+    }
+
+    QString locateStyleSheet()
+    {
+        // probono: Use ~/.config/stylesheet.qss or /etc/xdg/stylesheet.qss if exists
+        return QStandardPaths::locate(QStandardPaths::ConfigLocation, QStringLiteral("stylesheet.qss"), QStandardPaths::LocateFile);
+    }
+}
+
+StyleSheetLoader::StyleSheetLoader(QObject *parent)
+    : QObject(parent),
+      m_watcher(nullptr)
+{
+    if (qEnvironmentVariable("PANDA_STYLESHEET_WATCH") != QLatin1String("0")) {
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &StyleSheetLoader::checkForChange);
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &StyleSheetLoader::checkForChange);
+    }
+}
+
+StyleSheetLoader::FileState StyleSheetLoader::fileState(const QString &path)
+{
+    FileState state;
+    state.path = path;
+    if (!path.isEmpty()) {
+        const QFileInfo info(path);
+        state.modified = info.lastModified().toMSecsSinceEpoch();
+        state.size = info.size();
+    }
+    return state;
+}
+
+void StyleSheetLoader::checkForChange()
+{
+    // the directory is usually ~/.config, which other programs write to all
+    // the time; only a created, changed or removed style sheet counts
+    const FileState state = fileState(locateStyleSheet());
+    if (state == m_fileState)
+        return;
+
+    m_fileState = state;
+    resultCache().clear();
+    Q_EMIT styleSheetChanged();
+}
+
+StyleSheetLoader::Result StyleSheetLoader::load()
+{
+    Result result;
+    result.path = locateStyleSheet();
+    const FileState state = fileState(result.path);
+    if (m_watcher)
+        m_fileState = state;
+    if (result.path.isEmpty())
+        return result;
+
+    if (m_watcher)
+        watch(result.path);
+
+    const QString key = result.path + QLatin1Char('\n')
+                        + QString::number(state.modified) + QLatin1Char('\n')
+                        + QString::number(state.size);
+
+    QHash<QString, Result> &cache = resultCache();
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return it.value();
+
+    result.themeRules = ThemeParams::split(readFile(result.path), &result.styleSheet);
+    cache.insert(key, result);
+    return result;
+}
+
+QString StyleSheetLoader::readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return QString();
+
+    const qint64 size = file.size();
+    if (size <= 0)
+        return QString();
+
+    if (uchar *data = file.map(0, size)) {
+        QString content = QString::fromLatin1(reinterpret_cast<const char *>(data), int(size));
+        file.unmap(data);
+        return content;
+    }
+
+    // not mappable, e.g. on some virtual file systems
+    return QLatin1String(file.readAll());
+}
+
+void StyleSheetLoader::watch(const QString &path)
+{
+    if (!m_watcher->files().contains(path))
+        m_watcher->addPath(path);
+
+    const QString directory = QFileInfo(path).absolutePath();
+    if (!m_watcher->directories().contains(directory))
+        m_watcher->addPath(directory);
+}
@@ -0,0 +1,76 @@
+#ifndef STYLESHEETLOADER_H
+#define STYLESHEETLOADER_H
+
+#include "themeparams.h"
+
+#include <QObject>
+#include <QString>
+
+class QFileSystemWatcher;
+
+//* locates, reads and splits the application style sheet
+/**
+the result is cached per process for each (path, modification time, size), so re-creating
+the style, e.g. on a theme change, does not read and split the file again. The file is
+watched and changes are reported for live reload, unless PANDA_STYLESHEET_WATCH=0.
+*/
+class StyleSheetLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    //* what the style has to apply for the current style sheet file
+    struct Result
+    {
+        //* path of the style sheet, empty if there is none
+        QString path;
+
+        //* rules painted natively
+        ThemeParams::Rules themeRules = ThemeParams::NoRules;
+
+        //* rules that still need QApplication::setStyleSheet()
+        QString styleSheet;
+    };
+
+    //* constructor
+    explicit StyleSheetLoader(QObject *parent = nullptr);
+
+    //* result for the current style sheet file
+    Result load();
+
+Q_SIGNALS:
+    //* the watched style sheet file changed on disk
+    void styleSheetChanged();
+
+private Q_SLOTS:
+    //* report a change if the style sheet file was created, changed or removed
+    void checkForChange();
+
+private:
+    //* what tells one version of the style sheet file from another
+    struct FileState
+    {
+        QString path;
+        qint64 modified = -1;
+        qint64 size = -1;
+
+        bool operator==(const FileState &other) const
+        { return path == other.path && modified == other.modified && size == other.size; }
+    };
+
+    //* state of the file at path, empty for no file
+    static FileState fileState(const QString &path);
+
+    //* read file through a memory mapping
+    static QString readFile(const QString &path);
+
+    //* watch path and its directory, the latter catches editors replacing the file
+    void watch(const QString &path);
+
+    QFileSystemWatcher *m_watcher;
+
+    //* style sheet file as last loaded or reported
+    FileState m_fileState;
+};
+
+#endif // STYLESHEETLOADER_H
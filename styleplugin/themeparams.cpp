@@ -0,0 +1,257 @@
+#include "themeparams.h"
+
+#include <QHash>
+#include <QLinearGradient>
+#include <QRectF>
+#include <QStringList>
+#include <QVector>
+
+const QColor ThemeParams::toolBarBackground(0xe7, 0xe8, 0xeb);
+const QColor ThemeParams::statusBarBackground(0xe7, 0xe8, 0xeb);
+const QColor ThemeParams::progressBarBackground(Qt::white);
+
+const QGradientStops ThemeParams::buttonStops {
+    {0.0, QColor(0xff, 0xff, 0xff)}, {0.1, QColor(0xdd, 0xdd, 0xdd)},
+    {0.39, QColor(0xee, 0xee, 0xee)}, {0.4, QColor(0xcc, 0xcc, 0xcc)}, {1.0, QColor(0xff, 0xff, 0xff)}};
+const QGradientStops ThemeParams::defaultButtonStops {
+    {0.0, QColor(0x95, 0x95, 0xd3)}, {0.1, QColor(0xb9, 0xcb, 0xf9)},
+    {0.39, QColor(0x69, 0xac, 0xe3)}, {0.4, QColor(0x4c, 0x95, 0xd9)}, {1.0, QColor(0x8d, 0xd2, 0xfb)}};
+const QGradientStops ThemeParams::hoverButtonStops {
+    {0.0, QColor(0xff, 0xff, 0xff)}, {0.1, QColor(0xdd, 0xdd, 0xdd)},
+    {0.39, QColor(0xee, 0xee, 0xff)}, {0.4, QColor(0xdd, 0xdd, 0xbb)}, {1.0, QColor(0xff, 0xff, 0xff)}};
+const QColor ThemeParams::buttonBorder(Qt::gray);
+const QColor ThemeParams::defaultButtonText(Qt::white);
+const QColor ThemeParams::hoverButtonText(Qt::black);
+
+const QColor ThemeParams::selectionText(Qt::white);
+const QColor ThemeParams::selectionBackground(0x33, 0x6f, 0xc9);
+const QColor ThemeParams::alternateBackground(0xee, 0xf1, 0xf5);
+
+const QGradientStops ThemeParams::menuSelectedStops {
+    {0.0, QColor(0x7c, 0x90, 0xff)}, {0.1, QColor(0x6f, 0x84, 0xf1)},
+    {0.9, QColor(0x46, 0x55, 0xf0)}, {1.0, QColor(0x3b, 0x44, 0xab)}};
+const QColor ThemeParams::menuSelectedText(Qt::white);
+const QColor ThemeParams::menuBackground(0xee, 0xee, 0xee);
+
+const QColor ThemeParams::searchFieldFocusText(Qt::white);
+const QColor ThemeParams::completerPopupBackground(0xee, 0xee, 0xee);
+const QGradientStops ThemeParams::mainMenuBarStops {
+    {0.0, QColor(0xff, 0xff, 0xff)}, {0.1, QColor(0xee, 0xee, 0xee)}, {0.39, QColor(0xee, 0xee, 0xee)},
+    {0.4, QColor(0xdd, 0xdd, 0xdd)}, {0.954, QColor(0xee, 0xee, 0xee)}, {1.0, QColor(0xbb, 0xbb, 0xbb)}};
+
+namespace
+{
+    // The rules of the shipped stylesheet.qss that ThemeParams paints natively.
+    // A user sheet has to contain a rule with the same selector and the same
+    // declarations for it to be covered; anything else is left to Qt.
+    const char NativeStyleSheet[] = R"(
+QToolBar {
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #7c90ff, stop: 0.1 #6f84f1, stop: 0.9 #4655f0, stop: 1 #3b44ab);
+  background-color: #e7e8eb;
+}
+QStatusBar {
+  background-color: #e7e8eb;
+}
+QProgressBar {
+  height: 20px;
+  background-color: white;
+  text-align: center;
+  color: transparent;
+}
+QPushButton[default="true"], QProgressBar::chunk {
+  color: white;
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #9595d3, stop: 0.1 #b9cbf9, stop: 0.39 #69ace3, stop: 0.4 #4c95d9, stop: 1 #8dd2fb);
+}
+QPushButton:hover {
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #fff, stop: 0.1 #ddd, stop: 0.39 #eef, stop: 0.4 #ddb, stop: 1 #fff);
+  color: black;
+}
+QPushButton {
+  font-size: 11.5pt;
+  height: 20px;
+  padding-top: 1px;
+  padding-bottom: 0px;
+  padding-left: 20px;
+  padding-right: 20px;
+  border-radius: 11px;
+  border-width: 1px;
+  border-style: solid;
+  border-color: grey;
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #fff, stop: 0.1 #ddd, stop: 0.39 #eee, stop: 0.4 #ccc, stop: 1 #fff);
+}
+QDialogButtonBox {
+  margin-top: 30px;
+  padding-top: 30px;
+}
+QWidget {
+  show-decoration-selected: 1;
+  selection-color: white;
+  selection-background-color: #336fc9;
+  alternate-background-color: #eef1f5;
+}
+QMenu::item:pressed, QMenuBar::item:pressed, QMenu::item:selected {
+  color: white;
+  background: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #7c90ff, stop: 0.1 #6f84f1, stop: 0.9 #4655f0, stop: 1 #3b44ab);
+}
+QMenuBar, QMenuBar::item {
+  background: transparent;
+}
+QMenu, QMenu::item {
+  background: #eee;
+}
+QObject[objectName="sidePane"] {
+  background-color: yellow;
+}
+QLineEdit#actionSearch {
+  border-radius: 0px;
+  background-color: transparent;
+  padding-left: 10px;
+  padding-right: 10px;
+  height: 100%;
+  border-width: 0px;
+  border-style: solid;
+  border-color: grey;
+}
+QLineEdit#actionSearch:focus {
+  color: white;
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #7c90ff, stop: 0.1 #6f84f1, stop: 0.9 #4655f0, stop: 1 #3b44ab);
+  height: 100%;
+}
+QListView#actionCompleterPopup {
+  background: #eee;
+  selection-background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #7c90ff, stop: 0.1 #6f84f1, stop: 0.9 #4655f0, stop: 1 #3b44ab);
+}
+MainWindow#menuBar {
+  background-color: QLinearGradient( x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #fff, stop: 0.1 #eee, stop: 0.39 #eee, stop: 0.4 #ddd, stop: 0.954 #eee, stop: 1 #bbb);
+}
+)";
+
+    // Same order as the rules in NativeStyleSheet
+    const ThemeParams::Rule NativeRules[] = {
+        ThemeParams::ToolBarRule,
+        ThemeParams::StatusBarRule,
+        ThemeParams::ProgressBarRule,
+        ThemeParams::DefaultButtonRule,
+        ThemeParams::HoverButtonRule,
+        ThemeParams::ButtonRule,
+        ThemeParams::DialogButtonBoxRule,
+        ThemeParams::SelectionRule,
+        ThemeParams::MenuSelectedRule,
+        ThemeParams::MenuBarTransparentRule,
+        ThemeParams::MenuBackgroundRule,
+        ThemeParams::SidePaneRule,
+        ThemeParams::SearchFieldRule,
+        ThemeParams::SearchFieldFocusRule,
+        ThemeParams::CompleterPopupRule,
+        ThemeParams::MainMenuBarRule,
+    };
+
+    struct StyleRule
+    {
+        QString selector;
+        QString declarations;
+        QString text;
+    };
+
+    QString stripComments(const QString &styleSheet)
+    {
+        QString result;
+        result.reserve(styleSheet.size());
+        int pos = 0;
+        while (pos < styleSheet.size()) {
+            const int start = styleSheet.indexOf(QLatin1String("/*"), pos);
+            if (start < 0) {
+                result += styleSheet.midRef(pos);
+                break;
+            }
+            result += styleSheet.midRef(pos, start - pos);
+            const int end = styleSheet.indexOf(QLatin1String("*/"), start + 2);
+            if (end < 0)
+                break;
+            pos = end + 2;
+        }
+        return result;
+    }
+
+    QString normalizedList(const QString &list, QChar separator)
+    {
+        QStringList items;
+        const auto parts = list.splitRef(separator, QString::SkipEmptyParts);
+        for (const QStringRef &part : parts) {
+            const QString item = part.toString().simplified();
+            if (!item.isEmpty())
+                items.append(item);
+        }
+        return items.join(separator);
+    }
+
+    QVector<StyleRule> parseRules(const QString &styleSheet)
+    {
+        QVector<StyleRule> rules;
+        const QString text = stripComments(styleSheet);
+        int pos = 0;
+        while (pos < text.size()) {
+            const int open = text.indexOf(QLatin1Char('{'), pos);
+            if (open < 0)
+                break;
+            const int close = text.indexOf(QLatin1Char('}'), open + 1);
+            if (close < 0)
+                break;
+
+            StyleRule rule;
+            rule.selector = normalizedList(text.mid(pos, open - pos), QLatin1Char(','));
+            rule.declarations = normalizedList(text.mid(open + 1, close - open - 1), QLatin1Char(';'));
+            rule.text = text.mid(pos, close + 1 - pos).trimmed();
+            rules.append(rule);
+            pos = close + 1;
+        }
+        return rules;
+    }
+
+    QString ruleKey(const StyleRule &rule)
+    {
+        return rule.selector + QLatin1Char('{') + rule.declarations;
+    }
+
+    const QHash<QString, ThemeParams::Rule> &nativeRules()
+    {
+        static const QHash<QString, ThemeParams::Rule> rules = [] {
+            QHash<QString, ThemeParams::Rule> hash;
+            const QVector<StyleRule> parsed = parseRules(QString::fromLatin1(NativeStyleSheet));
+            Q_ASSERT(parsed.size() == int(sizeof(NativeRules) / sizeof(NativeRules[0])));
+            for (int i = 0; i < parsed.size(); ++i)
+                hash.insert(ruleKey(parsed.at(i)), NativeRules[i]);
+            return hash;
+        }();
+        return rules;
+    }
+}
+
+ThemeParams::Rules ThemeParams::split(const QString &styleSheet, QString *remainder)
+{
+    Rules covered = NoRules;
+    QStringList remaining;
+    const QHash<QString, Rule> &native = nativeRules();
+    const QVector<StyleRule> rules = parseRules(styleSheet);
+    for (const StyleRule &rule : rules) {
+        if (rule.selector.isEmpty())
+            continue;
+        auto it = native.constFind(ruleKey(rule));
+        if (it != native.constEnd()) {
+            covered |= it.value();
+        } else {
+            remaining.append(rule.text);
+        }
+    }
+
+    if (remainder)
+        *remainder = remaining.join(QLatin1Char('\n'));
+    return covered;
+}
+
+QLinearGradient ThemeParams::gradient(const QRectF &rect, const QGradientStops &stops)
+{
+    QLinearGradient gradient(rect.topLeft(), rect.bottomLeft());
+    gradient.setStops(stops);
+    return gradient;
+}
@@ -0,0 +1,89 @@
+#ifndef THEMEPARAMS_H
+#define THEMEPARAMS_H
+
+#include <QColor>
+#include <QGradient>
+#include <QString>
+
+class QRectF;
+class QLinearGradient;
+
+//* the look that used to come from the shipped stylesheet.qss, drawn natively by BaseStyle
+/**
+installing an application style sheet wraps every widget in a QStyleSheetStyle proxy and
+makes Qt parse and match the rules in every process. The rules of the shipped sheet are
+recognized here and painted by the style itself; only what goes beyond them still has to
+be handed to QApplication::setStyleSheet().
+*/
+class ThemeParams
+{
+public:
+    //* the shipped rules ThemeParams can replace
+    enum Rule {
+        NoRules = 0,
+        ToolBarRule = 1 << 0,
+        StatusBarRule = 1 << 1,
+        ProgressBarRule = 1 << 2,
+        DefaultButtonRule = 1 << 3,     // also the progress bar chunk
+        HoverButtonRule = 1 << 4,
+        ButtonRule = 1 << 5,
+        DialogButtonBoxRule = 1 << 6,   // had no visible effect, covered as a no-op
+        SelectionRule = 1 << 7,
+        MenuSelectedRule = 1 << 8,
+        MenuBarTransparentRule = 1 << 9,
+        MenuBackgroundRule = 1 << 10,
+        SidePaneRule = 1 << 11,         // never matched Filer's side pane, covered as a no-op
+        SearchFieldRule = 1 << 12,
+        SearchFieldFocusRule = 1 << 13,
+        CompleterPopupRule = 1 << 14,
+        MainMenuBarRule = 1 << 15,
+    };
+    Q_DECLARE_FLAGS(Rules, Rule)
+
+    //* split a style sheet into the rules covered natively and the remaining style sheet
+    static Rules split(const QString &styleSheet, QString *remainder);
+
+    //* vertical gradient over rect
+    static QLinearGradient gradient(const QRectF &rect, const QGradientStops &stops);
+
+    // QToolBar, QStatusBar
+    static const QColor toolBarBackground;
+    static const QColor statusBarBackground;
+
+    // QProgressBar
+    static constexpr int progressBarHeight = 20;
+    static const QColor progressBarBackground;
+
+    // QPushButton, QPushButton[default="true"], QPushButton:hover
+    static const QGradientStops buttonStops;
+    static const QGradientStops defaultButtonStops;
+    static const QGradientStops hoverButtonStops;
+    static const QColor buttonBorder;
+    static const QColor defaultButtonText;
+    static const QColor hoverButtonText;
+    static constexpr int buttonRadius = 11;
+    static constexpr int buttonHorizontalPadding = 20;
+    static constexpr qreal buttonFontPointSize = 11.5;
+
+    // QWidget selection
+    static const QColor selectionText;
+    static const QColor selectionBackground;
+    static const QColor alternateBackground;
+
+    // QMenu, QMenuBar
+    static const QGradientStops menuSelectedStops;
+    static const QColor menuSelectedText;
+    static const QColor menuBackground;
+    static constexpr int menuFontPixelSize = 15;
+
+    // QLineEdit#actionSearch, QListView#actionCompleterPopup, MainWindow#menuBar of the Menu
+    // application; the focused search field and the completer selection use menuSelectedStops
+    static constexpr int searchFieldHorizontalPadding = 10;
+    static const QColor searchFieldFocusText;
+    static const QColor completerPopupBackground;
+    static const QGradientStops mainMenuBarStops;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ThemeParams::Rules)
+
+#endif // THEMEPARAMS_H